@@ -7,6 +7,8 @@ for eye data C header files, for all available eyes.
 Optional command line parameters are:
   1. The directory to write the output header files to.
   2. The base source directory to find eye definition subdirectories in.
+  3. The polar map format, either 'separate' (the default) or 'interleaved'.
+  4. The width of the polar map guard band, 0 (the default) for none or 'auto'.
 """
 
 import os
@@ -35,7 +37,7 @@ def main():
   for subdir in subdirs:
     configFile = Path(subdir).joinpath('config.eye')
     if configFile.exists():
-      generateEyeCode(str(outputDir), str(configFile))
+      generateEyeCode(str(outputDir), str(configFile), getParam(3, 'separate'), getParam(4, '0'))
 
 if __name__ == "__main__":
   main()
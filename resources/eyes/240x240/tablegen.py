@@ -9,17 +9,25 @@ in the output directory:
   displacement_[M]_[E}.h    - a displacement mapping lookup table.
   polarAngle_[M].h          - a polar mapping lookup table.
   polarDist_[M]_[E]_[I]_[S] - a polar distance lookup table.
+  polarMap_[M]_[E]_[I]_[S]  - the polar angle and distance tables interleaved into one,
+                              generated instead of the two above when requested.
 
   Where:   [M] = map radius (usually 240)
            [E] = eye radius
            [I] = iris radius
            [S] = slit pupil radius
 
+  The polar map names have a _g[G] suffix when they are padded with a guard band [G] pixels wide, and the
+  eye's header defines GUARDED_POLAR_MAPS so the renderer builds the kernels that make use of it.
+
 Requires Pillow imaging and numpy libraries.
 
 Optional command line parameters are:
   1. The directory to write the output header files to.
   2.  The name of a json config file that specifies the eye's settings. Defaults to config.eye.
+  3.  The polar map format, either 'separate' (the default) or 'interleaved'.
+  4.  The width of the guard band to pad the polar maps with. Defaults to 0 (none), or 'auto'
+      to cover every gaze position the eye controller can produce.
 """
 
 import copy
@@ -255,8 +263,53 @@ def screenToMap(mapRadius: int, eyeRadius: int, value: int) -> float:
   return math.atan2(value, math.sqrt(eyeRadius * eyeRadius - value * value)) / M_PI_2 * mapRadius
 
 
+def gazeGuard(mapRadius: int) -> int:
+  """
+  Returns the width of guard band needed for the polar maps to cover every gaze position the eye
+  controller produces: a full saccade, plus a microsaccade beyond that. No point of the eye is more
+  than mapRadius from the gaze position, so nothing further is needed for the displacement.
+  """
+  saccade = 2 * mapRadius - SCREEN_WIDTH * M_PI_2
+  return math.ceil(saccade * (0.75 + 0.07)) + 1
+
+
+def outputInterleavedMap(outputDir: str, name: str, polarAngle, polarDist, size: int) -> None:
+  """
+  Writes out the polar angle and distance maps as a single table of 16-bit entries, with the distance
+  in the high byte and the angle in the low byte. The entries are written column by column so that the
+  renderer, which works down each column of the screen, reads them sequentially. Quadrants 2 and 4 need
+  the angle of the transposed point, which the renderer derives from the stored one, so check that this
+  holds for every point inside the map.
+  """
+  for y in range(size):
+    for x in range(size):
+      if polarDist[y * size + x] == 255:
+        continue
+      angle = polarAngle[y * size + x]
+      transposed = polarAngle[x * size + y]
+      if transposed != 255 - angle + (1 if x == y else 0):
+        raise Exception(f'{name} - the angle at [{x}, {y}] cannot be derived from its transposed point')
+
+  base = f'{outputDir}/{name}'
+  print(f'Writing {name} lookup table to {base}.(h, cpp)')
+  with open(f'{base}.h', 'w') as header:
+    header.write('#pragma once\n\n')
+    header.write('#include <Arduino.h>\n\n')
+    header.write(f'extern const uint16_t {name}[];\n')
+  with open(base + '.cpp', 'w') as cpp:
+    cpp.write(f'// {name} interleaved polar distance (high byte) and angle (low byte) lookup table, by column\n')
+    cpp.write(f'#include "{name}.h"\n\n')
+    cpp.write(f'const uint16_t {name}[{size} * {size}] PROGMEM = {{\n')
+    hexTable = HexTable(cpp, size * size, 12, 4)
+    for x in range(size):
+      for y in range(size):
+        i = y * size + x
+        hexTable.write((int(polarDist[i]) << 8) | int(polarAngle[i]))
+
+
 def outputPolarMaps(outputDir: str, angleName: str, distName: str, mapRadius: int,
-                    eyeRadius: int, irisRadius: int, slitPupilRadius: int = 0) -> None:
+                    eyeRadius: int, irisRadius: int, slitPupilRadius: int = 0,
+                    interleavedName: str = None, guard: int = 0) -> None:
   """
   Generates one quadrant of a polar coordinate map radius x radius in size, suitable for
   mapping iris and sclera images into polar coordinates for display.
@@ -269,14 +322,19 @@ def outputPolarMaps(outputDir: str, angleName: str, distName: str, mapRadius: in
   :param irisRadius:      the radius of the eye's iris, in pixels.
   :param slitPupilRadius: the radius of the slit pupil. Zero will result in a round pupil,
                           larger values (between 1 and irisRadius) make a taller/thinner pupil.
+  :param interleavedName: if set, write a single interleaved map with this name instead of
+                          separate angle and distance maps.
+  :param guard:           the width of the guard band to pad the far edges of the quadrant with.
+                          Everything in it is outside the eye, so it reads as the back of the eye.
   """
 
   if slitPupilRadius < 0 or slitPupilRadius > irisRadius:
     raise Exception(f'slitPupilRadius must be a value between 0 and {irisRadius}')
 
   mapRadius2 = mapRadius * mapRadius
-  polarAngle = np.full(mapRadius2, 0, dtype=np.uint8)
-  polarDist = np.full(mapRadius2, 0, dtype=np.uint8)
+  size = mapRadius + guard
+  polarAngle = np.full(size * size, 0, dtype=np.uint8)
+  polarDist = np.full(size * size, 0, dtype=np.uint8)
 
   # Iris size, in polar map pixels
   iRad = screenToMap(mapRadius, eyeRadius, irisRadius)
@@ -286,10 +344,10 @@ def outputPolarMaps(outputDir: str, angleName: str, distName: str, mapRadius: in
   distIndex = 0
 
   # Only the first quadrant is calculated, the other three are mirrored/rotated from this.
-  for y in range(mapRadius):
+  for y in range(size):
     dy = y + 0.5  # Y distance to map center
     dy2 = dy * dy
-    for x in range(mapRadius):
+    for x in range(size):
       dx = x + 0.5  # X distance to map center
       d2 = dx * dx + dy2  # Distance to center of map, squared
       if d2 > mapRadius2:
@@ -321,8 +379,8 @@ def outputPolarMaps(outputDir: str, angleName: str, distName: str, mapRadius: in
             # We can do this because pixels to the left and above this one will always have a value the same
             # or higher than the one we are currently calculating.
             # This results in a massive speedup compared to the original brute-force M4_Eyes approach.
-            start = 254 if x == 0 and y == 0 else polarDist[(y - 1) * mapRadius] if x == 0 else polarDist[
-              y * mapRadius + x - 1]
+            start = 254 if x == 0 and y == 0 else polarDist[(y - 1) * size] if x == 0 else polarDist[
+              y * size + x - 1]
             # Convert from 254-128 values, to 0-126
             start = 255 - start
             for i in range(start, 128):
@@ -355,8 +413,11 @@ def outputPolarMaps(outputDir: str, angleName: str, distName: str, mapRadius: in
       angleIndex += 1
       distIndex += 1
 
-  outputGreyscaleCpp(outputDir, angleName, polarAngle, mapRadius, mapRadius)
-  outputGreyscaleCpp(outputDir, distName, polarDist, mapRadius, mapRadius)
+  if interleavedName is not None:
+    outputInterleavedMap(outputDir, interleavedName, polarAngle, polarDist, size)
+  else:
+    outputGreyscaleCpp(outputDir, angleName, polarAngle, size, size)
+    outputGreyscaleCpp(outputDir, distName, polarDist, size, size)
 
 
 def outputDisplacement(outputDir: str, name: str, mapRadius: int, eyeRadius: int) -> None:
@@ -394,7 +455,8 @@ def outputDisplacement(outputDir: str, name: str, mapRadius: int, eyeRadius: int
 
 
 def outputConfig(out: TextIO, config: EyeConfig, mapRadius: int, dispMapName: str,
-                 angleMapName: str, distMapName: str, filenameMappings: dict[str, str]) -> None:
+                 angleMapName: str, distMapName: str, filenameMappings: dict[str, str],
+                 interleavedMapName: str = None, guard: int = 0) -> None:
   """
   Writes out the C++ EyeDefinition
   EyeDefinition {configName} = {
@@ -403,7 +465,7 @@ def outputConfig(out: TextIO, config: EyeConfig, mapRadius: int, dispMapName: st
       {irisRadius, {irisTexture, irisWidth, irisHeight}, irisColor, irisSpin, iSpin, mirror},
       {{scleraTexture, scleraWidth, scleraHeight}, scleraColor, scleraSpin, iSpin, mirror},
       {upper, lower, color},
-      {mapRadius, angleMapName, dispMapName}
+      {mapRadius, angleMapName, dispMapName[, interleavedMapName[, guard]]}
   };
   """
 
@@ -430,7 +492,13 @@ def outputConfig(out: TextIO, config: EyeConfig, mapRadius: int, dispMapName: st
   mirror = 1023 if config.sclera.mirror else 0
   out.write(f'      {{ {{ {scleraDef} }}, {config.sclera.color}, {config.sclera.angle}, {config.sclera.spin}, {config.sclera.iSpin}, {mirror} }},\n')
   out.write(f'      {{ {upper}, {lower}, {config.eyelid.color} }},\n')
-  out.write(f'      {{ {mapRadius}, {angleMapName}, {distMapName} }}\n')
+  guardDef = f', {guard}' if guard > 0 else ''
+  if interleavedMapName is not None:
+    out.write(f'      {{ {mapRadius}, nullptr, nullptr, {interleavedMapName}{guardDef} }}\n')
+  elif guard > 0:
+    out.write(f'      {{ {mapRadius}, {angleMapName}, {distMapName}, nullptr{guardDef} }}\n')
+  else:
+    out.write(f'      {{ {mapRadius}, {angleMapName}, {distMapName} }}\n')
   out.write('  };\n')
 
 
@@ -439,7 +507,7 @@ def toAbsoluteStr(basePath: Path, filename: str) -> str:
   return str(path.resolve()) if path.is_absolute() else str(basePath.joinpath(path).resolve())
 
 
-def generateEyeCode(outputDir: str, configFile: str):
+def generateEyeCode(outputDir: str, configFile: str, polarFormat: str = 'separate', guard: str = '0'):
   if not os.path.exists(outputDir):
     sys.stderr.write(f'The path {outputDir} does not exist')
     exit(1)
@@ -448,6 +516,10 @@ def generateEyeCode(outputDir: str, configFile: str):
     sys.stderr.write(f'{outputDir} is not a directory (absolute: {absolutePath})')
     exit(1)
 
+  if polarFormat not in ('separate', 'interleaved'):
+    sys.stderr.write(f'Unknown polar map format {polarFormat}, expected separate or interleaved')
+    exit(1)
+
   print(f'Loading eye configuration from {configFile}')
   configs = loadEyeConfig(configFile)
 
@@ -455,26 +527,37 @@ def generateEyeCode(outputDir: str, configFile: str):
   basePath = Path(configFile).parent.absolute()
 
   mapRadius = 240
+  guardWidth = gazeGuard(mapRadius) if guard == 'auto' else int(guard)
+  guardSuffix = f'_g{guardWidth}' if guardWidth > 0 else ''
 
   eyeName = configs[0].name.split('.', 1)[0]
   outputFilename = f'{outputDir}/{eyeName}.h'
-  angleMapName = f'polarAngle_{mapRadius}'
-  distMapName = f'polarDist_{mapRadius}_{configs[0].radius}_{configs[0].iris.radius}_{configs[0].pupil.slitRadius}'
+  angleMapName = f'polarAngle_{mapRadius}{guardSuffix}'
+  distMapName = f'polarDist_{mapRadius}_{configs[0].radius}_{configs[0].iris.radius}_{configs[0].pupil.slitRadius}{guardSuffix}'
   dispMapName = f'disp_{mapRadius}_{configs[0].radius}'
+  interleavedMapName = None
+  if polarFormat == 'interleaved':
+    interleavedMapName = f'polarMap_{mapRadius}_{configs[0].radius}_{configs[0].iris.radius}_{configs[0].pupil.slitRadius}{guardSuffix}'
 
   outputPolarMaps(outputDir, angleMapName, distMapName, mapRadius, configs[0].radius,
-                  configs[0].iris.radius, configs[0].pupil.slitRadius)
+                  configs[0].iris.radius, configs[0].pupil.slitRadius, interleavedMapName, guardWidth)
   outputDisplacement(outputDir, dispMapName, mapRadius, configs[0].radius)
 
   print(f'Writing iris, sclera and eyelid data to {outputFilename}')
   with open(outputFilename, 'w') as eyeFile:
     eyeFile.write('#pragma once\n\n')
     eyeFile.write('#include "../eyes.h"\n')
-    eyeFile.write(f'#include "{angleMapName}.h"\n')
-    eyeFile.write(f'#include "{distMapName}.h"\n')
+    if interleavedMapName is not None:
+      eyeFile.write(f'#include "{interleavedMapName}.h"\n')
+    else:
+      eyeFile.write(f'#include "{angleMapName}.h"\n')
+      eyeFile.write(f'#include "{distMapName}.h"\n')
     eyeFile.write(f'#include "{dispMapName}.h"\n')
     if configs[0].eyelid.upperFilename is None:
       eyeFile.write(f'#include "noeyelids_{configs[0].radius}.h"\n')
+    if guardWidth > 0:
+      # The renderer only builds its kernels for guard-banded maps when an eye needs them
+      eyeFile.write('\n#define GUARDED_POLAR_MAPS\n')
     eyeFile.write(f'\nnamespace {eyeName} {{\n')
 
     filenameMappings = {}
@@ -505,7 +588,8 @@ def generateEyeCode(outputDir: str, configFile: str):
         outputImageFile(eyeFile, fullPath, scleraName, 800, 200)
         filenameMappings[config.sclera.filename] = scleraName
 
-      outputConfig(eyeFile, config, mapRadius, dispMapName, angleMapName, distMapName, filenameMappings)
+      outputConfig(eyeFile, config, mapRadius, dispMapName, angleMapName, distMapName, filenameMappings,
+                   interleavedMapName, guardWidth)
 
     eyeFile.write('}\n')  # End of namespace block
 
@@ -514,4 +598,6 @@ def generateEyeCode(outputDir: str, configFile: str):
 if __name__ == "__main__":
   outputDir = getParam(1, '.')
   configFile = getParam(2, 'config.eye')
-  generateEyeCode(outputDir, configFile)
+  polarFormat = getParam(3, 'separate')
+  guard = getParam(4, '0')
+  generateEyeCode(outputDir, configFile, polarFormat, guard)
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "../displays/RamDisplay.h"
+#include "../eyes/EyeController.h"
+
+/// Measures how long the renderer takes to draw a complete eye, across a grid of gaze positions, blink
+/// amounts and pupil sizes for each eye definition. Every frame is drawn into RAM, so only the rendering
+/// is timed and not any sending to a display. The results are printed over Serial as CSV, one line per
+/// point in the grid plus a summary line for each eye with "all" in the grid columns. A second table then
+/// compares the texel addressing the renderer does with lookup tables against the arithmetic it replaced.
+namespace bench {
+
+struct Gaze {
+  float x;
+  float y;
+};
+
+constexpr std::array<Gaze, 5> gazes{{{0.0f, 0.0f}, {-1.0f, 0.0f}, {1.0f, 0.0f}, {0.0f, -1.0f}, {0.0f, 1.0f}}};
+constexpr std::array<float, 3> blinks{0.0f, 0.5f, 0.9f};
+constexpr std::array<float, 3> pupils{0.0f, 0.5f, 1.0f};
+
+/// Frames drawn at each point in the grid before timing starts, so the damped eyelids have time to settle
+constexpr uint32_t settleFrames{30};
+
+/// The kinds of pixel a frame is made of
+enum PixelClass : uint16_t {
+  Eyelid = 1, Sclera, Iris, Pupil, Back, numPixelClasses
+};
+
+using ClassCounts = std::array<uint32_t, numPixelClasses>;
+
+/// Makes a copy of an eye with the same geometry, but with each part a flat color that identifies it.
+/// Drawing this shows which pixels of the real eye fall into each PixelClass.
+inline EyeDefinition classProbe(const EyeDefinition &def) {
+  EyeDefinition probe{
+      {}, def.radius, PixelClass::Back, def.tracking, def.squint, def.displacement,
+      PupilParams{PixelClass::Pupil, def.pupil.slitRadius, def.pupil.min, def.pupil.max},
+      IrisParams{def.iris.radius, Image{}, PixelClass::Iris},
+      ScleraParams{Image{}, PixelClass::Sclera},
+      EyelidParams{def.eyelids.upper, def.eyelids.lower, PixelClass::Eyelid},
+      def.polar
+  };
+  memcpy(probe.name, def.name, sizeof(probe.name));
+  return probe;
+}
+
+/// \return the sample at the given fraction of the way through some sorted samples.
+inline uint32_t percentile(const std::vector<uint32_t> &sorted, float fraction) {
+  return sorted[static_cast<size_t>(static_cast<float>(sorted.size() - 1) * fraction + 0.5f)];
+}
+
+inline void printRow(const char *name, const char *gaze, const char *blink, const char *pupil,
+                     std::vector<uint32_t> &ns, const ClassCounts &counts, uint32_t frames) {
+  std::sort(ns.begin(), ns.end());
+  const uint32_t pixels = RamDisplay::width * RamDisplay::height;
+  Serial.printf("%s,%s,%s,%s,%.1f,%.1f,%.1f,%.2f,%lu,%lu,%lu,%lu,%lu\n", name, gaze, blink, pupil,
+                percentile(ns, 0.5f) / 1000.0f, percentile(ns, 0.9f) / 1000.0f, percentile(ns, 0.99f) / 1000.0f,
+                static_cast<float>(percentile(ns, 0.5f)) / pixels,
+                static_cast<unsigned long>(counts[Eyelid] / frames), static_cast<unsigned long>(counts[Sclera] / frames),
+                static_cast<unsigned long>(counts[Iris] / frames), static_cast<unsigned long>(counts[Pupil] / frames),
+                static_cast<unsigned long>(counts[Back] / frames));
+}
+
+/// Stops the compiler from optimising away the work being timed
+inline volatile uint32_t sink;
+
+/// Addresses a texel the way the renderer did before TextureLookup, with a multiply and divide per coordinate.
+inline uint16_t texelByDivision(const Image &texture, uint32_t angle, int32_t distance, int32_t rowFactor) {
+  const int32_t tx = angle * texture.width / 1024;
+  const int32_t ty = distance * rowFactor / 32768;
+  return texture.get(tx, ty);
+}
+
+/// Times one pass of texel addressing over every point of a polar map, returning the median of the samples.
+template<typename Ticks, typename Address>
+uint32_t timeAddressing(const EyeDefinition &def, uint32_t samples, Ticks &ticks, Address &&address) {
+  const PolarParams &polar = def.polar;
+  const uint32_t stride = polar.mapRadius + polar.guard;
+  std::vector<uint32_t> times;
+  for (uint32_t i = 0; i < samples; i++) {
+    uint32_t sum = 0;
+    const uint32_t start = ticks();
+    for (uint32_t y = 0; y < polar.mapRadius; y++) {
+      for (uint32_t x = 0; x < polar.mapRadius; x++) {
+        const uint32_t offset = y * stride + x;
+        // Spread the quadrant's angles around the whole circle, as the four quadrants do
+        const uint32_t angle = (polar.angle[offset] + ((x ^ y) & 3) * 256) & 1023;
+        sum += address(angle, polar.distance[offset]);
+      }
+    }
+    times.push_back(ticks() - start);
+    sink = sum;
+  }
+  std::sort(times.begin(), times.end());
+  return percentile(times, 0.5f);
+}
+
+/// Compares texel addressing with TextureLookup tables against the multiply/divide arithmetic they replaced,
+/// for every eye with an iris or sclera texture. The times are the median ns per point of the polar map.
+template<typename Ticks>
+void runTextureAddressing(EyeDefinition *definitions, size_t count, uint32_t samples, Ticks &ticks,
+                          float nsPerTick) {
+  Serial.println(F("eye,divide_ns_per_px,lookup_ns_per_px"));
+  for (size_t e = 0; e < count; e++) {
+    const EyeDefinition &def = definitions[e];
+    if ((!def.sclera.hasTexture() && !def.iris.hasTexture()) || !def.polar.angle) {
+      continue;
+    }
+    // The iris rows as they are with the pupil half open
+    const float irisValue = 1.0f - (def.pupil.min + (def.pupil.max - def.pupil.min) * 0.5f);
+    const int32_t irisRowFactor = def.iris.hasTexture() ?
+                                  static_cast<int32_t>(32768.0f / 126.0f * (def.iris.texture.height - 1) / irisValue) : 0;
+    const int32_t scleraRowFactor = def.sclera.hasTexture() ? 32768 * def.sclera.texture.height / 128 : 0;
+    TextureLookup scleraLookup{}, irisLookup{};
+    if (def.sclera.hasTexture()) {
+      scleraLookup.setColumns(def.sclera.texture);
+      scleraLookup.setRows(def.sclera.texture, scleraRowFactor);
+    }
+    if (def.iris.hasTexture()) {
+      irisLookup.setColumns(def.iris.texture);
+      irisLookup.setRows(def.iris.texture, irisRowFactor);
+    }
+
+    // Points that aren't on a textured part of the eye cost the same either way
+    const uint32_t divided = timeAddressing(def, samples, ticks, [&](uint32_t angle, int32_t distance) -> uint32_t {
+      if (distance < 128) {
+        return def.sclera.hasTexture() ? texelByDivision(def.sclera.texture, angle, distance, scleraRowFactor) : 0;
+      }
+      if (distance < 255 && def.iris.hasTexture()) {
+        return texelByDivision(def.iris.texture, angle, distance - 128, irisRowFactor);
+      }
+      return 0;
+    });
+    const uint32_t looked = timeAddressing(def, samples, ticks, [&](uint32_t angle, int32_t distance) -> uint32_t {
+      if (distance < 128) {
+        return def.sclera.hasTexture() ? scleraLookup.get(def.sclera.texture, angle, distance) : 0;
+      }
+      if (distance < 255 && def.iris.hasTexture()) {
+        return irisLookup.get(def.iris.texture, angle, distance - 128);
+      }
+      return 0;
+    });
+    const float points = static_cast<float>(def.polar.mapRadius) * def.polar.mapRadius;
+    Serial.printf("%s,%.2f,%.2f\n", def.name, static_cast<float>(divided) * nsPerTick / points,
+                  static_cast<float>(looked) * nsPerTick / points);
+  }
+}
+
+/// Runs the benchmark over some eye definitions.
+/// \param definitions the eyes to benchmark.
+/// \param count the number of eyes.
+/// \param samples the number of frames to time at each point in the grid.
+/// \param ticks returns the current time in ticks, wrapping at 32 bits.
+/// \param nsPerTick the length of a tick, in nanoseconds.
+template<typename Ticks>
+void run(EyeDefinition *definitions, size_t count, uint32_t samples, Ticks &&ticks, float nsPerTick) {
+  Serial.println(F("eye,gaze,blink,pupil,p50_us,p90_us,p99_us,ns_per_pixel,eyelid,sclera,iris,pupil,back"));
+  auto *display = new RamDisplay();
+  for (size_t e = 0; e < count; e++) {
+    std::array<EyeDefinition, 1> eye{definitions[e]};
+    std::array<EyeDefinition, 1> probe{classProbe(eye[0])};
+    EyeController<1, RamDisplay> controller({DisplayDefinition<RamDisplay>{display, eye[0]}}, false, false, false);
+
+    std::vector<uint32_t> eyeNs, pointNs;
+    ClassCounts eyeCounts{};
+    for (const Gaze &gaze: gazes) {
+      for (const float blink: blinks) {
+        for (const float pupil: pupils) {
+          controller.setPosition(gaze.x, gaze.y);
+          controller.setBlink(blink);
+          controller.setPupil(pupil);
+          for (uint32_t i = 0; i < settleFrames; i++) {
+            controller.renderFrame();
+          }
+
+          pointNs.clear();
+          for (uint32_t i = 0; i < samples; i++) {
+            // Start again from a blank screen, so every sample draws the whole eye
+            controller.updateDefinitions(eye);
+            const uint32_t start = ticks();
+            controller.renderFrame();
+            pointNs.push_back(static_cast<uint32_t>(static_cast<float>(ticks() - start) * nsPerTick));
+          }
+          eyeNs.insert(eyeNs.end(), pointNs.begin(), pointNs.end());
+
+          controller.updateDefinitions(probe);
+          controller.renderFrame();
+          ClassCounts counts{};
+          const uint16_t *pixels = display->frameBuffer();
+          for (uint32_t i = 0; i < RamDisplay::width * RamDisplay::height; i++) {
+            if (pixels[i] < numPixelClasses) {
+              counts[pixels[i]]++;
+            }
+          }
+          for (size_t c = 0; c < counts.size(); c++) {
+            eyeCounts[c] += counts[c];
+          }
+          controller.updateDefinitions(eye);
+
+          char gazeText[16], blinkText[8], pupilText[8];
+          snprintf(gazeText, sizeof(gazeText), "%.1f/%.1f", gaze.x, gaze.y);
+          snprintf(blinkText, sizeof(blinkText), "%.1f", blink);
+          snprintf(pupilText, sizeof(pupilText), "%.1f", pupil);
+          printRow(eye[0].name, gazeText, blinkText, pupilText, pointNs, counts, 1);
+        }
+      }
+    }
+    printRow(eye[0].name, "all", "all", "all", eyeNs, eyeCounts, gazes.size() * blinks.size() * pupils.size());
+  }
+  delete display;
+
+  runTextureAddressing(definitions, count, samples, ticks, nsPerTick);
+}
+
+}
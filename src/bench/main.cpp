@@ -0,0 +1,66 @@
+// Benchmarks the renderer over every eye, printing the results as CSV. See RenderBenchmark.h.
+// On the host:  platformio run -e native_bench && .pio/build/native_bench/program
+// On a Teensy:  platformio run -e bench --target upload, then watch the serial monitor
+
+#include "RenderBenchmark.h"
+
+#include "../eyes/240x240/bigBlue.h"
+#include "../eyes/240x240/brown.h"
+#include "../eyes/240x240/cat.h"
+#include "../eyes/240x240/demon.h"
+#include "../eyes/240x240/doe.h"
+#include "../eyes/240x240/doomRed.h"
+#include "../eyes/240x240/doomSpiral.h"
+#include "../eyes/240x240/dragon.h"
+#include "../eyes/240x240/fizzgig.h"
+#include "../eyes/240x240/hypnoRed.h"
+#include "../eyes/240x240/skull.h"
+#include "../eyes/240x240/snake.h"
+#include "../eyes/240x240/toonstripe.h"
+
+// The rest of the eyes don't fit in a Teensy 4.0's flash alongside the ones above
+#ifdef NATIVE_BUILD
+#include "../eyes/240x240/anime.h"
+#include "../eyes/240x240/blueFlame1.h"
+#include "../eyes/240x240/blueFlame2.h"
+#include "../eyes/240x240/firebox.h"
+#include "../eyes/240x240/fish.h"
+#include "../eyes/240x240/flame.h"
+#include "../eyes/240x240/hazel.h"
+#include "../eyes/240x240/leopard.h"
+#include "../eyes/240x240/newt.h"
+#include "../eyes/240x240/spikes.h"
+#endif
+
+EyeDefinition benchEyes[] = {
+    bigBlue::eye, brown::eye, cat::eye, demon::left, doe::left, doomRed::eye, doomSpiral::left, dragon::eye,
+    fizzgig::eye, hypnoRed::eye, skull::eye, snake::eye, toonstripe::eye,
+#ifdef NATIVE_BUILD
+    anime::left, blueFlame1::eye, blueFlame2::eye, firebox::eye, fish::eye, flame::eye, hazel::eye,
+    leopard::left, newt::eye, spikes::eye,
+#endif
+};
+
+#ifdef NATIVE_BUILD
+#include <chrono>
+
+int main() {
+  const auto ticks = [] {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  };
+  bench::run(benchEyes, std::size(benchEyes), 20, ticks, 1.0f);
+  return 0;
+}
+#else
+void setup() {
+  Serial.begin(115200);
+  while (!Serial && millis() < 5000);
+  // The cycle counter gives much finer timings than micros()
+  const auto ticks = [] { return ARM_DWT_CYCCNT; };
+  bench::run(benchEyes, std::size(benchEyes), 5, ticks, 1e9f / F_CPU_ACTUAL);
+  Serial.println(F("Done"));
+}
+
+void loop() {}
+#endif
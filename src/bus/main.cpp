@@ -0,0 +1,149 @@
+// Checks how SharedBus arbitrates between devices, using the simulated wire and devices in MockBus.h.
+// Prints each check and exits with 1 if any of them fail.
+// Run it with: platformio run -e native_bus && .pio/build/native_bus/program
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <vector>
+
+#include "../displays/MockBus.h"
+#include "../displays/SharedBus.h"
+#include "../native/Check.h"
+
+/// Steps a bus through queueing and polling by hand.
+static void checkQueueing() {
+  MockWire wire;
+  MockDevice first(wire, 100), second(wire, 100), third(wire, 100);
+  SharedBus<MockDevice, 2> bus;
+  const int firstSlot = bus.attach(&first);
+  const int secondSlot = bus.attach(&second);
+  check(firstSlot == 0 && secondSlot == 1 && bus.size() == 2, "devices get the next free slot");
+  check(bus.attach(&third) == -1 && bus.size() == 2, "a full bus refuses another device");
+
+  bus.poll();
+  check(first.transfers == 0 && second.transfers == 0, "polling with nothing queued starts nothing");
+
+  bus.enqueue(firstSlot);
+  check(!bus.isQueued(firstSlot) && first.transferActive(), "a transfer on a free bus starts straight away");
+
+  bus.enqueue(secondSlot);
+  check(bus.isQueued(secondSlot) && second.transfers == 0, "a transfer on a busy bus waits");
+
+  wire.advance(50);
+  bus.poll();
+  check(bus.isQueued(secondSlot) && second.transfers == 0, "polling mid-transfer leaves the queue alone");
+
+  wire.advance(50);
+  bus.poll();
+  check(!bus.isQueued(secondSlot) && second.transferActive() && !first.transferActive(),
+        "polling after a transfer finishes starts the next one");
+
+  // Both queue while the second is sending. The first has had its turn, so the second goes next,
+  // even though it's after the first in slot order.
+  bus.enqueue(firstSlot);
+  wire.advance(100);
+  bus.enqueue(secondSlot);
+  bus.poll();
+  check(first.transferActive() && bus.isQueued(secondSlot), "queued devices take turns");
+  wire.advance(100);
+  bus.poll();
+  check(second.transferActive() && !bus.isQueued(secondSlot), "the other device goes next");
+  check(wire.collisions == 0, "no transfers overlapped");
+}
+
+/// A device that draws a frame, queues it on the bus, then draws the next once it has been sent, much like
+/// an asynchronously updated display.
+struct Eye {
+  MockDevice device;
+  size_t slot;
+  uint32_t renderUs;
+  uint32_t readyAt;
+  /// The number of transfers other devices started since this one queued, while it was still queued
+  uint32_t passedOver{};
+  uint32_t mostPassedOver{};
+};
+
+/// Runs several devices with different transfer times on one bus for a while.
+/// \param count the number of devices.
+static void checkSharing(size_t count) {
+  MockWire wire;
+  SharedBus<MockDevice> bus;
+  std::vector<Eye> eyes;
+  eyes.reserve(count);
+  for (size_t i = 0; i < count; i++) {
+    // Transfers take 2-3ms, much like a 240x240 frame at 40-70MHz, and drawing is quicker than sending
+    const uint32_t n = static_cast<uint32_t>(i);
+    eyes.push_back(Eye{MockDevice(wire, 2000 + n * 200), 0, 300 + n * 50, n * 37});
+  }
+  for (Eye &eye: eyes) {
+    eye.slot = static_cast<size_t>(bus.attach(&eye.device));
+  }
+
+  uint32_t totalTransfers = 0;
+  uint32_t overlaps = 0;
+  uint32_t idleWithWaiting = 0;
+  const uint32_t runUs = 2'000'000;
+  for (; wire.now < runUs; wire.advance(10)) {
+    for (Eye &eye: eyes) {
+      if (bus.isQueued(eye.slot) || eye.device.transferActive()) {
+        bus.poll();
+      } else if (wire.now >= eye.readyAt && eye.readyAt != UINT32_MAX) {
+        eye.passedOver = 0;
+        bus.enqueue(eye.slot);
+        eye.readyAt = UINT32_MAX;
+      } else if (eye.readyAt == UINT32_MAX) {
+        // Sent, so start drawing the next frame
+        eye.readyAt = wire.now + eye.renderUs;
+      }
+
+      // See who, if anyone, started sending
+      uint32_t transfers = 0;
+      for (const Eye &other: eyes) {
+        transfers += other.device.transfers;
+      }
+      for (; totalTransfers < transfers; totalTransfers++) {
+        for (Eye &other: eyes) {
+          if (bus.isQueued(other.slot)) {
+            other.passedOver++;
+            other.mostPassedOver = std::max(other.mostPassedOver, other.passedOver);
+          }
+        }
+      }
+    }
+
+    uint32_t active = 0, queued = 0;
+    for (const Eye &eye: eyes) {
+      active += eye.device.transferActive() ? 1 : 0;
+      queued += bus.isQueued(eye.slot) ? 1 : 0;
+    }
+    overlaps += active > 1 ? 1 : 0;
+    idleWithWaiting += active == 0 && queued > 0 ? 1 : 0;
+  }
+
+  uint32_t fewest = UINT32_MAX, most = 0, mostPassedOver = 0;
+  for (const Eye &eye: eyes) {
+    fewest = std::min(fewest, eye.device.transfers);
+    most = std::max(most, eye.device.transfers);
+    mostPassedOver = std::max(mostPassedOver, eye.mostPassedOver);
+  }
+  printf("     %zu devices: %u-%u transfers each, bus %.1f%% busy, waited for at most %u others\n", count, fewest,
+         most, wire.utilization() * 100.0f, mostPassedOver);
+
+  char what[80];
+  snprintf(what, sizeof(what), "%zu devices: no two transfers on the wire at once", count);
+  check(overlaps == 0 && wire.collisions == 0, what);
+  snprintf(what, sizeof(what), "%zu devices: every device is served within one round", count);
+  check(mostPassedOver <= count - 1, what);
+  snprintf(what, sizeof(what), "%zu devices: every device gets an equal share", count);
+  check(most - fewest <= 1, what);
+  snprintf(what, sizeof(what), "%zu devices: the bus never sits idle with frames waiting", count);
+  check(idleWithWaiting == 0, what);
+}
+
+int main() {
+  checkQueueing();
+  checkSharing(5);
+  checkSharing(6);
+  return checkResult();
+}
@@ -0,0 +1,59 @@
+// Checks the search behind SPI clock calibration, using the simulated links in MockBus.h.
+// Prints each check and exits with 1 if any of them fail.
+// Run it with: platformio run -e native_calibration && .pio/build/native_calibration/program
+
+#include <cstdio>
+
+#include "../displays/MockBus.h"
+#include "../displays/SpiCalibration.h"
+#include "../native/Check.h"
+
+constexpr uint32_t minHz{4'000'000};
+constexpr uint32_t stepHz{1'000'000};
+
+/// \return the speed the search should settle on for a link that works up to limitHz.
+static uint32_t withMargin(uint32_t limitHz) {
+  return limitHz / 100 * (100 - calibrationMarginPercent);
+}
+
+int main() {
+  uint32_t probes = 0;
+  uint32_t hz = findFastestClock([&](uint32_t) { probes++; return false; }, minHz, displaySafeClock);
+  check(hz == 0, "a link that never works gives 0");
+  check(probes == 1, "a link that never works is only tried at the slowest speed");
+
+  hz = findFastestClock([](uint32_t) { return true; }, minHz, displaySafeClock);
+  check(hz == displaySafeClock, "a link that works at maxHz gives maxHz");
+
+  hz = findFastestClock([](uint32_t) { return true; }, minHz, 120'000'000, stepHz);
+  check(hz == 120'000'000, "a link that works at a larger maxHz gives that maxHz");
+
+  // A link that works exactly up to a given speed
+  const uint32_t limits[] = {5'000'000, 27'500'000, 63'000'000, 89'999'999};
+  for (const uint32_t limit: limits) {
+    probes = 0;
+    hz = findFastestClock([&](uint32_t probe) { probes++; return probe <= limit; }, minHz, displaySafeClock,
+                          stepHz);
+    char what[96];
+    snprintf(what, sizeof(what), "a link that works up to %u Hz gives that less the margin (%u Hz)", limit, hz);
+    check(hz <= withMargin(limit) && hz >= withMargin(limit - stepHz), what);
+    snprintf(what, sizeof(what), "  and takes %u probes to find it", probes);
+    check(probes <= 10, what);
+  }
+
+  // A link that gets gradually less reliable past its limit, like a long cable
+  for (uint32_t seed = 1; seed <= 5; seed++) {
+    MockSpiLink link(40'000'000, seed);
+    hz = findFastestClock([&](uint32_t probe) { return link.works(probe, 48); }, minHz, displaySafeClock,
+                          stepHz);
+    char what[96];
+    snprintf(what, sizeof(what), "a link that degrades past 40 MHz (seed %u) gives %u Hz", seed, hz);
+    check(hz >= withMargin(40'000'000 - stepHz) && hz <= withMargin(40'000'000 + 2 * stepHz), what);
+  }
+
+  // Never faster than a display can cope with, however good the loopback is
+  hz = findFastestClock([](uint32_t probe) { return probe <= 110'000'000; }, minHz, displaySafeClock);
+  check(hz <= displaySafeClock, "a loopback that works at 110 MHz stays within displaySafeClock");
+
+  return checkResult();
+}
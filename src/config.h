@@ -31,15 +31,40 @@
 
 #define USE_GC9A01A
 //#define USE_ST7789
+//#define USE_ST7789_PANEL
+
+#ifdef NATIVE_BUILD
+// The native build has no displays, so it draws into RAM instead
+#undef USE_GC9A01A
+#undef USE_ST7789
+#undef USE_ST7789_PANEL
+#define USE_RAM_DISPLAY
+#endif
 
 #ifdef USE_GC9A01A
 #include "displays/GC9A01A_Display.h"
+#include "displays/SpiCalibration.h"
 #elif defined USE_ST7789
 #include "displays/ST7789_Display.h"
 #ifdef ST7735_SPICLOCK
 #undef ST7735_SPICLOCK
 #endif
 #define ST7735_SPICLOCK 30'000'000
+#elif defined USE_ST7789_PANEL
+#include "displays/ST7789_Display.h"
+#include "displays/Viewport.h"
+#ifdef ST7735_SPICLOCK
+#undef ST7735_SPICLOCK
+#endif
+#define ST7735_SPICLOCK 30'000'000
+#elif defined USE_RAM_DISPLAY
+#include "displays/RamDisplay.h"
+#endif
+
+// 12-bit RGB444 pixels (see displays/Display.h) are only implemented for the GC9A01A. The ST7789 driver
+// offsets its address windows for the panel's rotation, which sending the pixels ourselves would skip.
+#if defined RGB444 && (defined USE_ST7789 || defined USE_ST7789_PANEL)
+#error "RGB444 is only supported with USE_GC9A01A"
 #endif
 
 // A list of all the different eye definitions we want to use
@@ -78,18 +103,39 @@ std::array<std::array<EyeDefinition, 2>, 13> eyeDefinitions{{
 // With two displays, one should be configured to mirror on the X axis. This simplifies
 // eyelid handling -- no need for distinct L-to-R or R-to-L inner loops. Just the X
 // coordinate of the iris is then reversed when drawing this eye, so they move the same.
+// DOUBLE_BUF lets the next frame be drawn while the previous one is still being sent, for a
+// higher frame rate. It needs USE_FB and ASYNC, and another ~115KB of RAM for each display.
+// With USE_FB but not ASYNC, each update sends only the rows the renderer changed, as a few address
+// windows, rather than one rectangle around everything that changed. This blocks while it sends.
+// INTERLACE builds on that by sending the even rows on one update and the odd rows on the next, which
+// doubles the update rate for moving eyes when the SPI bus is the bottleneck.
+// Several displays can share the same MOSI/SCK pins (with their own CS pins). With ASYNC, they then
+// take turns to send their frames, so there can be more eyes than the Teensy has SPI ports.
 #ifdef USE_GC9A01A
 GC9A01A_Config eyeInfo[] = {
-    // CS DC MOSI SCK RST ROT MIRROR USE_FB ASYNC
-    {0,  2, 26, 27, 3, 0, true,  true, true}, // Left display
-    {10, 9, 11, 13, 8, 0, false, true, true}, // Right display
+    // CS DC MOSI SCK RST ROT MIRROR USE_FB ASYNC DOUBLE_BUF INTERLACE
+    {0,  2, 26, 27, 3, 0, true,  true, true, false, false}, // Left display
+    {10, 9, 11, 13, 8, 0, false, true, true, false, false}, // Right display
 };
 #elif defined USE_ST7789
 ST7789_Config eyeInfo[] = {
-    // CS DC MOSI SCK RST ROT MIRROR USE_FB ASYNC
-    {-1,  2, 26, 27, 3, 0, true,  true, true}, // Left display
-    {-1, 9, 11, 13, 8, 0, false, true, true}, // Right display
+    // CS DC MOSI SCK RST ROT MIRROR USE_FB ASYNC DOUBLE_BUF INTERLACE
+    {-1,  2, 26, 27, 3, 0, true,  true, true, false, false}, // Left display
+    {-1, 9, 11, 13, 8, 0, false, true, true, false, false}, // Right display
 };
+#elif defined USE_ST7789_PANEL
+// Both eyes on a single panel, such as a 240x320 ST7789 rotated to landscape. WIDTH and HEIGHT are the
+// panel's native size, before rotation. Each eye is centred in its half of the panel. On a panel narrower
+// than 480 pixels the eyes are shrunk to fit, keeping 2 of every 3 pixels at 320 wide, so each is drawn
+// whole at 160x160. Mirroring is done per eye in software.
+ST7789_Config panelInfo{
+    // CS DC MOSI SCK RST ROT MIRROR USE_FB ASYNC DOUBLE_BUF INTERLACE WIDTH HEIGHT
+    10, 9, 11, 13, 8, 1, false, true, true, false, false, 240, 320
+};
+constexpr bool PANEL_MIRROR_LEFT{true};
+#elif defined USE_RAM_DISPLAY
+// MIRROR for each display
+bool eyeInfo[] = {true, false};
 #endif
 
 constexpr uint32_t EYE_DURATION_MS{4'000};
@@ -99,6 +145,18 @@ constexpr uint32_t EYE_DURATION_MS{4'000};
 /// setup works up to about 90,000,000. At 100,000,000 I start seeing corruption on the displays.
 constexpr uint32_t SPI_SPEED{30'000'000};
 
+/// Whether to find the fastest reliable SPI speed for each display at boot instead of using SPI_SPEED.
+/// The first time, this needs a wire from each display's MOSI pin to the MISO pin of its port (12 for
+/// SPI, 1 for SPI1). The result is saved in EEPROM and used from then on, unless RECALIBRATE_SPI is set.
+/// The loopback can't see the display or its cable, so the result is never more than displaySafeClock (90MHz).
+/// Only GC9A01A displays are calibrated, ST7789_t3 fixes its speed when it's built.
+constexpr bool CALIBRATE_SPI{false};
+constexpr bool RECALIBRATE_SPI{false};
+
+/// Whether to cache each eye's geometry while it holds its gaze. This makes spinning eyes and pupil
+/// resizing cheaper to draw, but needs about 170KB of RAM per eye. The cache isn't used with RENDER_ROWS.
+constexpr bool USE_GEOMETRY_CACHE{false};
+
 // Set to -1 to disable the blink button and/or joystick
 constexpr int8_t BLINK_PIN{-1};
 constexpr int8_t JOYSTICK_X_PIN{-1};
@@ -110,14 +168,25 @@ constexpr bool USE_PERSON_SENSOR{false};
 EyeController<2, GC9A01A_Display> *eyes{};
 #elif defined USE_ST7789
 EyeController<2, ST7789_Display> *eyes{};
+#elif defined USE_ST7789_PANEL
+EyeController<2, Viewport<ST7789_Display>> *eyes{};
+#elif defined USE_RAM_DISPLAY
+EyeController<2, RamDisplay> *eyes{};
+std::array<RamDisplay *, 2> ramDisplays{};
 #endif
 
 void initEyes(bool autoMove, bool autoBlink, bool autoPupils) {
   // Create the displays and eye controller
   auto &defs = eyeDefinitions.at(0);
 #ifdef USE_GC9A01A
-  auto l = new GC9A01A_Display(eyeInfo[0], SPI_SPEED);
-  auto r = new GC9A01A_Display(eyeInfo[1], SPI_SPEED);
+  uint32_t speeds[2]{SPI_SPEED, SPI_SPEED};
+  if (CALIBRATE_SPI) {
+    for (size_t i = 0; i < 2; i++) {
+      speeds[i] = calibratedSpiSpeed(eyeInfo[i].cs, eyeInfo[i].mosi, eyeInfo[i].sck, SPI_SPEED, RECALIBRATE_SPI);
+    }
+  }
+  auto l = new GC9A01A_Display(eyeInfo[0], speeds[0]);
+  auto r = new GC9A01A_Display(eyeInfo[1], speeds[1]);
   const DisplayDefinition<GC9A01A_Display> left{l, defs[0]};
   const DisplayDefinition<GC9A01A_Display> right{r, defs[1]};
   eyes = new EyeController<2, GC9A01A_Display>({left, right}, autoMove, autoBlink, autoPupils);
@@ -127,5 +196,20 @@ void initEyes(bool autoMove, bool autoBlink, bool autoPupils) {
   const DisplayDefinition<ST7789_Display> left{l, defs[0]};
   const DisplayDefinition<ST7789_Display> right{r, defs[1]};
   eyes = new EyeController<2, ST7789_Display>({left, right}, autoMove, autoBlink, autoPupils);
+#elif defined USE_ST7789_PANEL
+  // Each eye gets half the panel (as it is after rotation), shrunk to fit if need be
+  auto panel = new ST7789_Display(panelInfo);
+  const auto viewports = splitPanel(panel, panel->width(), panel->height(), PANEL_MIRROR_LEFT);
+  const DisplayDefinition<Viewport<ST7789_Display>> left{viewports[0], defs[0]};
+  const DisplayDefinition<Viewport<ST7789_Display>> right{viewports[1], defs[1]};
+  eyes = new EyeController<2, Viewport<ST7789_Display>>({left, right}, autoMove, autoBlink, autoPupils);
+#elif defined USE_RAM_DISPLAY
+  ramDisplays = {new RamDisplay(eyeInfo[0]), new RamDisplay(eyeInfo[1])};
+  const DisplayDefinition<RamDisplay> left{ramDisplays[0], defs[0]};
+  const DisplayDefinition<RamDisplay> right{ramDisplays[1], defs[1]};
+  eyes = new EyeController<2, RamDisplay>({left, right}, autoMove, autoBlink, autoPupils);
 #endif
+  if (USE_GEOMETRY_CACHE && !eyes->setGeometryCache(true)) {
+    Serial.println(F("Not enough memory for the geometry cache"));
+  }
 }
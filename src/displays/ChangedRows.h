@@ -0,0 +1,144 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+/// Roughly how many pixels could be sent in the time it takes to start a new write to a display. Neighbouring
+/// rows are only sent together as a single rectangle when that saves more than it costs in extra pixels.
+constexpr uint32_t writeCost = 16;
+
+/// The parts of the screen that changed in a frame, as the span of columns that changed on each row.
+struct ChangedRows {
+  static constexpr uint16_t width{240};
+  static constexpr uint16_t height{240};
+
+  /// The first column that changed on each row
+  std::array<uint8_t, height> start{};
+  /// One past the last column that changed on each row, or 0 if nothing on the row changed
+  std::array<uint8_t, height> end{};
+
+  void clear() {
+    end.fill(0);
+  }
+
+  /// Records that part of a column changed. Columns must be added from left to right.
+  /// \param x the column.
+  /// \param minY the first row that changed.
+  /// \param maxY one past the last row that changed.
+  void addColumn(uint32_t x, uint32_t minY, uint32_t maxY) {
+    for (uint32_t y = minY; y < maxY; y++) {
+      if (!end[y]) {
+        start[y] = x;
+      }
+      end[y] = x + 1;
+    }
+  }
+
+  /// Records that part of a row changed.
+  /// \param y the row.
+  /// \param minX the first column that changed.
+  /// \param maxX one past the last column that changed.
+  void addRow(uint32_t y, uint32_t minX, uint32_t maxX) {
+    if (!end[y] || minX < start[y]) start[y] = minX;
+    if (maxX > end[y]) end[y] = maxX;
+  }
+
+  /// Groups the changed rows into rectangles, merging neighbouring rows wherever the extra pixels that
+  /// brings in cost less than the writes it saves.
+  /// \param fn called with the x, y, width and height of each rectangle.
+  template<typename Fn>
+  void forEachRect(Fn &&fn) const {
+    uint32_t y = 0;
+    while (y < height) {
+      if (!end[y]) {
+        y++;
+        continue;
+      }
+      uint32_t top = y, minX = start[y], maxX = end[y], area = end[y] - start[y];
+      for (y++; y < height && end[y]; y++) {
+        const uint32_t newMin = std::min<uint32_t>(minX, start[y]);
+        const uint32_t newMax = std::max<uint32_t>(maxX, end[y]);
+        const uint32_t newArea = area + end[y] - start[y];
+        if ((newMax - newMin) * (y + 1 - top) - newArea > (y - top) * writeCost) {
+          break;
+        }
+        minX = newMin;
+        maxX = newMax;
+        area = newArea;
+      }
+      fn(minX, top, maxX - minX, y - top);
+    }
+  }
+};
+
+/// How long an interlaced display waits for another update before sending the rows it's holding back anyway
+constexpr uint32_t interlaceFlushMs{50};
+
+/// Splits a display's updates into alternating fields of even and odd rows, so that each update only sends
+/// half of what changed. The rows held back are sent with the next field, by which time they may have
+/// changed again, so while the eyes are moving they update twice as often at half the vertical resolution.
+class InterlacedRows {
+private:
+  /// Rows that have changed but haven't been sent yet
+  ChangedRows waiting{};
+  /// The rows to send next, 0 for even and 1 for odd
+  uint8_t field{};
+
+public:
+  /// \return the field that the last call to next() returned, 0 for even rows and 1 for odd.
+  uint8_t lastField() const {
+    return field ^ 1;
+  }
+
+  /// \return true if some rows are still waiting to be sent.
+  bool pending() const {
+    return std::any_of(waiting.end.begin(), waiting.end.end(), [](uint8_t e) { return e != 0; });
+  }
+
+  /// Adds the rows that have just changed to those waiting, then takes out the next field's rows.
+  /// \param changed the rows that changed in the latest frame.
+  /// \return the rows to send now.
+  ChangedRows next(const ChangedRows &changed) {
+    ChangedRows send{};
+    for (uint32_t y = 0; y < ChangedRows::height; y++) {
+      if (changed.end[y]) {
+        waiting.addRow(y, changed.start[y], changed.end[y]);
+      }
+      if ((y & 1) == field && waiting.end[y]) {
+        send.start[y] = waiting.start[y];
+        send.end[y] = waiting.end[y];
+        waiting.end[y] = 0;
+      }
+    }
+    field ^= 1;
+    return send;
+  }
+};
+
+/// Sends just the changed parts of a display library's frame buffer to the screen, each as its own
+/// address window, rather than the single rectangle around all of them that updateScreen() would send.
+/// This blocks until everything has been sent.
+/// \param display the display to update. It must be using a frame buffer.
+/// \param changed the parts of the frame buffer to send.
+template<typename Driver>
+void sendChangedRows(Driver *display, const ChangedRows &changed) {
+  uint16_t *frame = display->getFrameBuffer();
+  // The library writes straight to the screen while its frame buffer is switched off. Each rectangle is
+  // gathered a few rows at a time into a buffer of its own, since the library wants the pixels contiguous.
+  constexpr uint32_t gatherPixels{2048};
+  uint16_t gathered[gatherPixels];
+  display->useFrameBuffer(false);
+  changed.forEachRect([&](uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    const uint32_t rowsPerWrite = std::max<uint32_t>(1, gatherPixels / w);
+    for (uint32_t row = y; row < y + h; row += rowsPerWrite) {
+      const uint32_t rows = std::min(rowsPerWrite, y + h - row);
+      for (uint32_t r = 0; r < rows; r++) {
+        memcpy(&gathered[r * w], &frame[(row + r) * ChangedRows::width + x], w * sizeof(uint16_t));
+      }
+      display->writeRect(x, row, w, rows, gathered);
+    }
+  });
+  display->useFrameBuffer(true);
+}
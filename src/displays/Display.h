@@ -1,9 +1,16 @@
 #pragma once
 
 #include <Arduino.h>
+#include "ChangedRows.h"
 
 //#define SHOW_FPS
 
+// Send 12-bit RGB444 pixels rather than 16-bit 565, so each frame needs a quarter fewer bytes on the SPI bus.
+// Only GC9A01A_Display implements this, so config.h refuses to build it with any other display. It bypasses
+// the display's frame buffer, so use it with STREAM_STRIPS. Text, including the SHOW_FPS counter, isn't
+// supported. The saving hasn't been measured on hardware; the native_timing environment only predicts it.
+//#define RGB444
+
 template <typename T>
 class Display {
 public:
@@ -15,12 +22,51 @@ public:
     static_cast<T&>(*this).drawFastVLine(x, y, h, color565);
   }
 
+  /// Writes a vertical run of pixels to the display in a single call.
+  /// \param x the column to write to.
+  /// \param y the first row to write to.
+  /// \param h the number of pixels to write.
+  /// \param colors565 the h pixels to write, top to bottom, in 16-bit 565 RGB.
+  inline void writeColumn(int16_t x, int16_t y, int16_t h, const uint16_t *colors565) __attribute__((always_inline)) {
+    static_cast<T&>(*this).writeColumn(x, y, h, colors565);
+  }
+
+  /// Writes a horizontal run of pixels to the display in a single call.
+  /// \param x the first column to write to.
+  /// \param y the row to write to.
+  /// \param w the number of pixels to write.
+  /// \param colors565 the w pixels to write, left to right, in 16-bit 565 RGB.
+  inline void writeSpan(int16_t x, int16_t y, int16_t w, const uint16_t *colors565) __attribute__((always_inline)) {
+    static_cast<T&>(*this).writeSpan(x, y, w, colors565);
+  }
+
+  /// Writes a rectangle of pixels to the display in a single call.
+  /// \param x the first column to write to.
+  /// \param y the first row to write to.
+  /// \param w the width of the rectangle.
+  /// \param h the height of the rectangle.
+  /// \param colors565 the w * h pixels to write, row by row, in 16-bit 565 RGB.
+  inline void writeRect(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *colors565) __attribute__((always_inline)) {
+    static_cast<T&>(*this).writeRect(x, y, w, h, colors565);
+  }
+
+  /// Direct access to the display's frame buffer. Pixels are stored row-major, 16-bit 565 RGB.
+  /// Note that anything written here directly is not seen by the display's changed area
+  /// tracking, so prefer writeColumn()/writeSpan() unless the whole screen is being updated.
+  /// \return the frame buffer, or nullptr if the display is not using one.
+  uint16_t *frameBuffer() {
+    return static_cast<T&>(*this).frameBuffer();
+  }
+
   void drawText(uint16_t x, uint16_t y, char *text) {
     static_cast<T&>(*this).drawText(x, y, text);
   }
 
-  void update() {
-    static_cast<T&>(*this).update();
+  /// Sends the frame to the screen.
+  /// \param changed the parts of the frame that changed since the last update. Anything outside them
+  /// must be left as it is.
+  void update(const ChangedRows &changed) {
+    static_cast<T&>(*this).update(changed);
   }
 
   /// Whether the display is available for drawing to.
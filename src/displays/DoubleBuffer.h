@@ -0,0 +1,85 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cstring>
+
+/// A second frame buffer for a display driver, so the next frame can be drawn while the previous
+/// one is still being sent to the screen by DMA. Once a frame has been sent, the two buffers swap
+/// over and the rows the sent frame changed are copied across, so the renderer can keep redrawing
+/// only what has changed since the last frame.
+/// \tparam Driver the display library class. It must use a frame buffer and support
+/// setFrameBuffer(), updateScreenAsync(), asyncUpdateActive() and waitUpdateAsyncComplete().
+template<typename Driver>
+class DoubleBuffer {
+private:
+  static constexpr int16_t width{240};
+  static constexpr int16_t height{240};
+
+  Driver *display{};
+  void *allocation{};
+  uint16_t *buffers[2]{};
+  uint8_t back{};
+  int16_t minY{height};
+  int16_t maxY{-1};
+
+public:
+  ~DoubleBuffer() {
+    if (display && display->asyncUpdateActive()) {
+      display->waitUpdateAsyncComplete();
+    }
+    free(allocation);
+  }
+
+  /// Allocates the second buffer. The driver's own frame buffer must already be in use.
+  /// \param driver the display to double buffer.
+  /// \return true if double buffering is ready to use, false if there wasn't enough memory.
+  bool begin(Driver *driver) {
+    uint16_t *front = driver->getFrameBuffer();
+    if (!front) {
+      return false;
+    }
+    // Keep the buffer aligned to a cache line, since DMA reads it straight out of memory
+    allocation = malloc(width * height * sizeof(uint16_t) + 32);
+    if (!allocation) {
+      return false;
+    }
+    buffers[0] = front;
+    buffers[1] = reinterpret_cast<uint16_t *>((reinterpret_cast<uintptr_t>(allocation) + 31) & ~uintptr_t{31});
+    memcpy(buffers[1], front, width * height * sizeof(uint16_t));
+    display = driver;
+    back = 0;
+    return true;
+  }
+
+  /// \return true if double buffering is in use.
+  bool enabled() const {
+    return display;
+  }
+
+  /// Records that some rows of the back buffer have been drawn on.
+  /// \param y the first row drawn on.
+  /// \param h the number of rows drawn on.
+  void touch(int16_t y, int16_t h) {
+    const int16_t last = y + h - 1;
+    if (y < minY) minY = y < 0 ? 0 : y;
+    if (last > maxY) maxY = last >= height ? height - 1 : last;
+  }
+
+  /// Starts sending the back buffer to the screen, then swaps buffers and brings the new back buffer up
+  /// to date with it. The previous transfer must have finished.
+  /// \return true if the transfer started, false if it failed.
+  bool send() {
+    const bool started = display->updateScreenAsync();
+    uint16_t *sent = buffers[back];
+    back ^= 1;
+    // The DMA keeps its own copy of the transfer settings, so this is safe while it's running.
+    // If the transfer failed, the changed area is still marked and goes out with the next frame.
+    display->setFrameBuffer(buffers[back]);
+    if (minY <= maxY) {
+      memcpy(buffers[back] + minY * width, sent + minY * width, (maxY - minY + 1) * width * sizeof(uint16_t));
+    }
+    minY = height;
+    maxY = -1;
+    return started;
+  }
+};
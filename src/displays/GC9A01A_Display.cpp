@@ -10,8 +10,23 @@ GC9A01A_t3n *createDisplay(const GC9A01A_Config &config) {
   return new GC9A01A_t3n(config.cs, config.dc, config.rst, config.mosi, config.sck);
 }
 
+/// Finds the bus for the displays on an SPI port. Displays that share a port take turns to send their frames.
+/// \param sck the SCK pin of the port.
+/// \return the bus, or nullptr if there are already displays on more ports than the Teensy has.
+static SharedBus<GC9A01A_Display> *sharedBus(int8_t sck) {
+  static std::array<int8_t, 3> pins{-1, -1, -1};
+  static std::array<SharedBus<GC9A01A_Display>, 3> buses{};
+  for (size_t i = 0; i < pins.size(); i++) {
+    if (pins[i] == sck || pins[i] < 0) {
+      pins[i] = sck;
+      return &buses[i];
+    }
+  }
+  return nullptr;
+}
+
 GC9A01A_Display::GC9A01A_Display(const GC9A01A_Config &config, uint32_t spiSpeed) :
-    display(createDisplay(config)), asyncUpdates(config.asyncUpdates) {
+    display(createDisplay(config)) {
   static size_t displayNum{};
   Serial.print(F("Init GC9A01A display #"));
   Serial.print(displayNum);
@@ -27,6 +42,12 @@ GC9A01A_Display::GC9A01A_Display(const GC9A01A_Config &config, uint32_t spiSpeed
     display->sendCommand(GC9A01A_MADCTL, &mirrorTFT.at(config.rotation & 3), 1);
   }
 
+#ifdef RGB444
+  rgb444::begin(display);
+  if (config.useFrameBuffer) {
+    Serial.println(F("The frame buffer can't be used with RGB444"));
+  }
+#else
   if (config.useFrameBuffer) {
     Serial.print(displayNum);
     Serial.print(F(": useFrameBuffer() "));
@@ -35,6 +56,32 @@ GC9A01A_Display::GC9A01A_Display(const GC9A01A_Config &config, uint32_t spiSpeed
     } else {
       Serial.println(F("OK"));
     }
+    if (config.doubleBuffer && config.asyncUpdates) {
+      Serial.print(displayNum);
+      Serial.print(F(": doubleBuffer "));
+      Serial.println(doubleBuffer.begin(display) ? F("OK") : F("failed"));
+    }
+  }
+#endif
+  // Go by whether the frame buffer exists rather than what was asked for, since RGB444 never has one
+  // and allocating it can fail. Without it, everything is drawn straight to the display.
+  const bool hasFrameBuffer = display->getFrameBuffer() != nullptr;
+  interlace = config.interlace && hasFrameBuffer && !config.asyncUpdates;
+  if (config.interlace && !interlace) {
+    Serial.println(F("Interlacing needs a frame buffer and synchronous updates"));
+  }
+  if (config.asyncUpdates && !hasFrameBuffer) {
+    Serial.println(F("Async updates need a frame buffer, drawing synchronously"));
+  }
+  if (config.asyncUpdates && hasFrameBuffer) {
+    bus = sharedBus(config.sck);
+    const int slot = bus ? bus->attach(this) : -1;
+    if (slot < 0) {
+      Serial.println(F("Too many displays for the SPI bus, async updates disabled"));
+      bus = nullptr;
+    } else {
+      busSlot = slot;
+    }
   }
   Serial.println(F("Success"));
   this->displayNum = displayNum;
@@ -49,11 +96,55 @@ GC9A01A_Display::~GC9A01A_Display() {
 }
 
 void GC9A01A_Display::drawPixel(int16_t x, int16_t y, uint16_t color565) {
+#ifdef RGB444
+  rgb444::fillRect(display, x, y, 1, 1, color565);
+#else
   display->drawPixel(x, y, color565);
+  doubleBuffer.touch(y, 1);
+#endif
 }
 
 void GC9A01A_Display::drawFastVLine(int16_t x, int16_t y, int16_t height, uint16_t color565) {
+#ifdef RGB444
+  rgb444::fillRect(display, x, y, 1, height, color565);
+#else
   display->drawFastVLine(x, y, height, color565);
+  doubleBuffer.touch(y, height);
+#endif
+}
+
+void GC9A01A_Display::writeColumn(int16_t x, int16_t y, int16_t height, const uint16_t *colors565) {
+#ifdef RGB444
+  rgb444::writeRect(display, x, y, 1, height, colors565);
+#else
+  // writeRect() clips once for the whole run and copies straight into the frame buffer (when
+  // enabled), updating the changed area as it goes.
+  display->writeRect(x, y, 1, height, colors565);
+  doubleBuffer.touch(y, height);
+#endif
+}
+
+void GC9A01A_Display::writeSpan(int16_t x, int16_t y, int16_t width, const uint16_t *colors565) {
+#ifdef RGB444
+  rgb444::writeRect(display, x, y, width, 1, colors565);
+#else
+  display->writeRect(x, y, width, 1, colors565);
+  doubleBuffer.touch(y, 1);
+#endif
+}
+
+void GC9A01A_Display::writeRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t *colors565) {
+#ifdef RGB444
+  rgb444::writeRect(display, x, y, width, height, colors565);
+#else
+  // Without a frame buffer, this sets the display's address window once and streams the pixels straight out
+  display->writeRect(x, y, width, height, colors565);
+  doubleBuffer.touch(y, height);
+#endif
+}
+
+uint16_t *GC9A01A_Display::frameBuffer() {
+  return display->getFrameBuffer();
 }
 
 void GC9A01A_Display::drawText(int16_t x, int16_t y, char *text) {
@@ -61,9 +152,11 @@ void GC9A01A_Display::drawText(int16_t x, int16_t y, char *text) {
   display->setTextSize(2);
   display->setTextColor(WHITE, BLACK);
   display->print(text);
+  // Text can wrap, so assume it could have touched any row below where it started
+  doubleBuffer.touch(y, 240 - y);
 }
 
-void GC9A01A_Display::update() {
+void GC9A01A_Display::update(const ChangedRows &changed) {
 
 #ifdef SHOW_FPS
   // A per-display FPS counter
@@ -75,19 +168,59 @@ void GC9A01A_Display::update() {
   display->setTextSize(2);
   display->setTextColor(WHITE, BLACK);
   display->drawNumber(fps, 110, 110);
+  if (interlace) {
+    // Each update is only one field, so mark the count as fields per second
+    display->setCursor(110 + 12 * (fps > 99 ? 3 : fps > 9 ? 2 : 1), 110);
+    display->print("i");
+  }
+  doubleBuffer.touch(110, 16);
   framesDrawn++;
+  // The counter has to go out along with whatever else changed
+  ChangedRows rows = changed;
+  for (uint32_t y = 110; y < 126; y++) {
+    rows.addRow(y, 110, 170);
+  }
+#else
+  const ChangedRows &rows = changed;
 #endif
 
-  if (asyncUpdates) {
-    if (!display->updateScreenAsync()) {
-      Serial.print(F("updateScreenAsync() failed for display "));
-      Serial.println(displayNum);
-    }
+  if (bus) {
+    // Sent as soon as the bus is free, which may be straight away
+    bus->enqueue(busSlot);
+  } else if (display->getFrameBuffer()) {
+    // Only the parts of the frame that changed are sent, each as its own address window
+    sendChangedRows(display, interlace ? fields.next(rows) : rows);
+    sinceUpdate = 0;
   } else {
     display->updateScreen();
   }
 }
 
-bool GC9A01A_Display::isAvailable() const {
+bool GC9A01A_Display::isAvailable() {
+  if (bus) {
+    bus->poll();
+    if (bus->isQueued(busSlot)) {
+      return false;
+    }
+    // With double buffering, the back buffer can be drawn on while the front one is still being sent
+    return doubleBuffer.enabled() || !display->asyncUpdateActive();
+  }
+  if (interlace && sinceUpdate > interlaceFlushMs && fields.pending()) {
+    // Nothing has changed for a while, so send the rows that were held back rather than leave them stale
+    sendChangedRows(display, fields.next(ChangedRows{}));
+    sinceUpdate = 0;
+  }
   return !display->asyncUpdateActive();
 }
+
+void GC9A01A_Display::startTransfer() {
+  const bool started = doubleBuffer.enabled() ? doubleBuffer.send() : display->updateScreenAsync();
+  if (!started) {
+    Serial.print(F("updateScreenAsync() failed for display "));
+    Serial.println(displayNum);
+  }
+}
+
+bool GC9A01A_Display::transferActive() const {
+  return display->asyncUpdateActive();
+}
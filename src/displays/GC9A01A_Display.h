@@ -4,6 +4,13 @@
 #include <array>
 
 #include "Display.h"
+#include "DoubleBuffer.h"
+#include "SharedBus.h"
+
+// RGB444 is switched on in Display.h
+#ifdef RGB444
+#include "Rgb444.h"
+#endif
 
 #define RGBColor(r, g, b) GC9A01A_t3n::Color565(r, g, b)
 
@@ -17,13 +24,22 @@ typedef struct {
   bool mirror;          // Mirror the display in the X direction.
   bool useFrameBuffer;  // Whether to use frame buffering.
   bool asyncUpdates;    // Whether to update the screen asynchronously (for better performance).
+  bool doubleBuffer;    // Whether to draw the next frame while the last is sent (needs ~115KB more RAM).
+  bool interlace;       // Whether to send alternate rows on alternate updates (needs a frame buffer, not async).
 } GC9A01A_Config;
 
 class GC9A01A_Display : public Display<GC9A01A_Display> {
 private:
   GC9A01A_t3n* display;
-  bool asyncUpdates;
   int displayNum;
+  DoubleBuffer<GC9A01A_t3n> doubleBuffer{};
+  /// The SPI bus this display takes turns on when updating asynchronously
+  SharedBus<GC9A01A_Display> *bus{};
+  size_t busSlot{};
+  /// Set when sending alternate rows on alternate updates
+  bool interlace{};
+  InterlacedRows fields{};
+  elapsedMillis sinceUpdate{};
 
 #ifdef SHOW_FPS
   uint32_t framesDrawn{};
@@ -45,9 +61,23 @@ public:
 
   void drawFastVLine(int16_t x, int16_t y, int16_t height, uint16_t color565);
 
+  void writeColumn(int16_t x, int16_t y, int16_t height, const uint16_t *colors565);
+
+  void writeSpan(int16_t x, int16_t y, int16_t width, const uint16_t *colors565);
+
+  void writeRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t *colors565);
+
+  uint16_t *frameBuffer();
+
   void drawText(int16_t x, int16_t y, char *text);
 
-  void update();
+  void update(const ChangedRows &changed);
+
+  bool isAvailable();
+
+  /// Starts sending the frame buffer to the display asynchronously. Called by the bus when it's our turn.
+  void startTransfer();
 
-  bool isAvailable() const;
+  /// \return true if a frame is still being sent to the display.
+  bool transferActive() const;
 };
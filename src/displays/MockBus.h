@@ -0,0 +1,96 @@
+#pragma once
+
+#include <Arduino.h>
+
+/// A simulated SPI bus, for checking how SharedBus arbitrates between devices without any hardware. Time
+/// only moves on when advance() is called, so runs are repeatable.
+class MockWire {
+public:
+  /// The current simulated time, in microseconds
+  uint32_t now{};
+  /// The time at which the bus will next be free
+  uint32_t freeAt{};
+  /// The total time the bus has spent sending
+  uint32_t busyTime{};
+  /// The number of transfers started while another was still being sent. Anything but 0 is a bug.
+  uint32_t collisions{};
+
+  void advance(uint32_t us) {
+    now += us;
+  }
+
+  /// \return the fraction of the time so far that the bus has been sending.
+  float utilization() const {
+    return now ? static_cast<float>(busyTime) / static_cast<float>(now) : 0.0f;
+  }
+};
+
+/// A simulated device on a MockWire, where every transfer takes the same length of time.
+class MockDevice {
+private:
+  MockWire &wire;
+  uint32_t transferUs;
+  uint32_t doneAt{};
+
+public:
+  /// The number of transfers this device has started
+  uint32_t transfers{};
+
+  /// \param wire the bus the device is on.
+  /// \param transferUs how long each transfer takes, in microseconds.
+  MockDevice(MockWire &wire, uint32_t transferUs) : wire(wire), transferUs(transferUs) {}
+
+  void startTransfer() {
+    if (wire.now < wire.freeAt) {
+      wire.collisions++;
+    }
+    doneAt = wire.now + transferUs;
+    wire.freeAt = doneAt;
+    wire.busyTime += transferUs;
+    transfers++;
+  }
+
+  bool transferActive() const {
+    return wire.now < doneAt;
+  }
+};
+
+/// A simulated SPI link, for checking SPI clock calibration without any hardware. Transfers always arrive
+/// intact up to a given speed. Beyond that, a growing share of them get corrupted, much like a long cable.
+class MockSpiLink {
+private:
+  uint32_t limitHz;
+  uint32_t seed;
+
+public:
+  /// The number of transfers made so far
+  uint32_t transfers{};
+
+  /// \param limitHz the fastest speed that always works.
+  /// \param seed the seed for deciding which transfers beyond the limit get corrupted.
+  explicit MockSpiLink(uint32_t limitHz, uint32_t seed = 1) : limitHz(limitHz), seed(seed) {}
+
+  /// \return true if a transfer at the given speed arrived intact.
+  bool transfer(uint32_t hz) {
+    transfers++;
+    if (hz <= limitHz) {
+      return true;
+    }
+    // Every 1% over the limit corrupts another 10% of transfers
+    seed ^= seed << 13;
+    seed ^= seed >> 17;
+    seed ^= seed << 5;
+    const uint64_t overPercent = (static_cast<uint64_t>(hz - limitHz) * 100 + limitHz - 1) / limitHz;
+    return seed % 100 >= overPercent * 10;
+  }
+
+  /// \return true if the given number of transfers in a row all arrived intact.
+  bool works(uint32_t hz, uint8_t trials) {
+    for (uint8_t i = 0; i < trials; i++) {
+      if (!transfer(hz)) {
+        return false;
+      }
+    }
+    return true;
+  }
+};
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include <array>
+#include <cstdio>
+
+#include "Display.h"
+
+/// A display that draws into memory rather than onto a screen, so the renderer can run without any
+/// hardware. Frames can be saved as PPM images.
+/// \tparam displayWidth the width of the display, in pixels.
+/// \tparam displayHeight the height of the display, in pixels.
+template<int16_t displayWidth = 240, int16_t displayHeight = 240>
+class BasicRamDisplay : public Display<BasicRamDisplay<displayWidth, displayHeight>> {
+public:
+  static constexpr int16_t width{displayWidth};
+  static constexpr int16_t height{displayHeight};
+
+private:
+  std::array<uint16_t, width * height> pixels{};
+  bool mirror;
+
+public:
+  /// The number of frames drawn
+  uint32_t updates{};
+
+  /// \param mirror true to mirror the image in the X direction when it's saved, as a real display would.
+  explicit BasicRamDisplay(bool mirror = false) : mirror(mirror) {}
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color565) {
+    pixels[y * width + x] = color565;
+  }
+
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color565) {
+    for (int16_t i = 0; i < h; i++) {
+      pixels[(y + i) * width + x] = color565;
+    }
+  }
+
+  void writeColumn(int16_t x, int16_t y, int16_t h, const uint16_t *colors565) {
+    for (int16_t i = 0; i < h; i++) {
+      pixels[(y + i) * width + x] = colors565[i];
+    }
+  }
+
+  void writeSpan(int16_t x, int16_t y, int16_t w, const uint16_t *colors565) {
+    std::copy(colors565, colors565 + w, &pixels[y * width + x]);
+  }
+
+  void writeRect(int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *colors565) {
+    for (int16_t row = 0; row < h; row++) {
+      writeSpan(x, y + row, w, colors565 + row * w);
+    }
+  }
+
+  uint16_t *frameBuffer() {
+    return pixels.data();
+  }
+
+  void drawText(int16_t, int16_t, char *) {}
+
+  void update(const ChangedRows &) {
+    updates++;
+  }
+
+  bool isAvailable() {
+    return true;
+  }
+
+  /// \return the pixel at the given position, as it would appear on the screen.
+  uint16_t get(int16_t x, int16_t y) const {
+    return pixels[y * width + (mirror ? width - 1 - x : x)];
+  }
+
+  /// Saves several displays side by side as a single PPM image.
+  /// \param path the file to write.
+  /// \param displays the displays, from left to right.
+  /// \return true if the image was saved.
+  template<size_t count>
+  static bool writePpm(const char *path, const std::array<const BasicRamDisplay *, count> &displays) {
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+      return false;
+    }
+    fprintf(file, "P6\n%d %d\n255\n", static_cast<int>(width * count), height);
+    for (int16_t y = 0; y < height; y++) {
+      for (const BasicRamDisplay *display: displays) {
+        for (int16_t x = 0; x < width; x++) {
+          // Widen each channel of the 565 color to 8 bits
+          const uint16_t c = display->get(x, y);
+          const uint8_t r = c >> 11, g = c >> 5 & 0x3F, b = c & 0x1F;
+          const uint8_t rgb[3]{static_cast<uint8_t>(r << 3 | r >> 2), static_cast<uint8_t>(g << 2 | g >> 4),
+                               static_cast<uint8_t>(b << 3 | b >> 2)};
+          fwrite(rgb, 1, 3, file);
+        }
+      }
+    }
+    return fclose(file) == 0;
+  }
+};
+
+/// A RAM display the size of a single eye
+using RamDisplay = BasicRamDisplay<>;
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+
+/// Sending pixels in the 12-bit RGB444 interface format, which needs a quarter fewer bytes on the SPI bus
+/// than 16-bit 565. Two pixels are packed into every three bytes. The display libraries only know how to
+/// send 565, so the pixels go out through their sendCommand(), a chunk at a time.
+namespace rgb444 {
+
+constexpr uint8_t CASET{0x2A};  // Column address set
+constexpr uint8_t RASET{0x2B};  // Row address set
+constexpr uint8_t RAMWR{0x2C};  // Memory write
+constexpr uint8_t COLMOD{0x3A}; // Interface pixel format
+constexpr uint8_t RAMWRC{0x3C}; // Memory write continue
+
+/// The COLMOD value for 12 bits per pixel
+constexpr uint8_t format12Bit{0x03};
+
+/// The number of pixels sent per command. sendCommand() takes at most 255 bytes, and every command
+/// after the first has to carry on from a whole number of pixel pairs.
+constexpr uint16_t chunkPixels{170};
+
+/// Switches a display over to 12-bit pixels.
+template<typename Driver>
+void begin(Driver *display) {
+  display->sendCommand(COLMOD, &format12Bit, 1);
+}
+
+/// Writes a rectangle of pixels to the display, converting them from 565 to 444 on the way.
+/// \param display the display to write to.
+/// \param x the first column to write to. The whole rectangle must lie on the screen.
+/// \param y the first row to write to.
+/// \param w the width of the rectangle.
+/// \param h the height of the rectangle.
+/// \param colors565 the w * h pixels to write, row by row, in 16-bit 565 RGB.
+template<typename Driver>
+void writeRect(Driver *display, int16_t x, int16_t y, int16_t w, int16_t h, const uint16_t *colors565) {
+  const uint16_t x1 = x + w - 1;
+  const uint16_t y1 = y + h - 1;
+  const uint8_t columns[4]{static_cast<uint8_t>(x >> 8), static_cast<uint8_t>(x), static_cast<uint8_t>(x1 >> 8),
+                           static_cast<uint8_t>(x1)};
+  const uint8_t rows[4]{static_cast<uint8_t>(y >> 8), static_cast<uint8_t>(y), static_cast<uint8_t>(y1 >> 8),
+                        static_cast<uint8_t>(y1)};
+  display->sendCommand(CASET, columns, 4);
+  display->sendCommand(RASET, rows, 4);
+
+  uint8_t chunk[chunkPixels / 2 * 3];
+  uint8_t command = RAMWR;
+  uint32_t remaining = static_cast<uint32_t>(w) * h;
+  while (remaining) {
+    const uint32_t count = std::min<uint32_t>(remaining, chunkPixels);
+    uint8_t *out = chunk;
+    for (uint32_t i = 0; i < count; i += 2) {
+      // Keep the top 4 bits of each channel. An odd pixel at the very end is padded with black.
+      const uint16_t a = colors565[i];
+      const uint16_t b = i + 1 < count ? colors565[i + 1] : 0;
+      *out++ = (a >> 8 & 0xF0) | (a >> 7 & 0x0F);
+      *out++ = (a << 3 & 0xF0) | (b >> 12);
+      *out++ = (b >> 3 & 0xF0) | (b >> 1 & 0x0F);
+    }
+    // The padding nibble of an odd final pixel is never sent
+    display->sendCommand(command, chunk, (count * 3 + 1) / 2);
+    command = RAMWRC;
+    colors565 += count;
+    remaining -= count;
+  }
+}
+
+/// Fills a rectangle of the display with a single color.
+template<typename Driver>
+void fillRect(Driver *display, int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color565) {
+  uint16_t colors[chunkPixels];
+  for (auto &c: colors) {
+    c = color565;
+  }
+  // Fill a few rows at a time, so every write is from the one buffer
+  const int16_t rowsPerWrite = std::max(1, chunkPixels / w);
+  for (int16_t row = 0; row < h; row += rowsPerWrite) {
+    const int16_t rows = std::min<int16_t>(rowsPerWrite, h - row);
+    if (w * rows <= chunkPixels) {
+      writeRect(display, x, y + row, w, rows, colors);
+    } else {
+      for (int16_t col = 0; col < w; col += chunkPixels) {
+        writeRect(display, x + col, y + row, std::min<int16_t>(chunkPixels, w - col), 1, colors);
+      }
+    }
+  }
+}
+
+}
@@ -8,8 +8,23 @@ ST7789_t3 *createDisplay(const ST7789_Config &config) {
   return new ST7789_t3(config.cs, config.dc, config.mosi, config.sck, config.rst);
 }
 
+/// Finds the bus for the displays on an SPI port. Displays that share a port take turns to send their frames.
+/// \param sck the SCK pin of the port.
+/// \return the bus, or nullptr if there are already displays on more ports than the Teensy has.
+static SharedBus<ST7789_Display> *sharedBus(int8_t sck) {
+  static std::array<int8_t, 3> pins{-1, -1, -1};
+  static std::array<SharedBus<ST7789_Display>, 3> buses{};
+  for (size_t i = 0; i < pins.size(); i++) {
+    if (pins[i] == sck || pins[i] < 0) {
+      pins[i] = sck;
+      return &buses[i];
+    }
+  }
+  return nullptr;
+}
+
 ST7789_Display::ST7789_Display(const ST7789_Config &config) :
-    display(createDisplay(config)), asyncUpdates(config.asyncUpdates) {
+    display(createDisplay(config)) {
   static size_t displayNum{};
   Serial.print(F("Init ST7789 display #"));
   Serial.print(displayNum);
@@ -17,12 +32,18 @@ ST7789_Display::ST7789_Display(const ST7789_Config &config) :
   Serial.print(config.rotation);
   Serial.print(F(", mirror="));
   Serial.println(config.mirror);
+  // ST7789_t3 takes the panel's native size, and swaps it over itself for rotations 1 and 3
+  const uint16_t width = config.width ? config.width : 240;
+  const uint16_t height = config.height ? config.height : 240;
+  eyeSized = width == 240 && height == 240;
   if (config.cs < 0) {
     // Try to handle the ST7789 displays without CS pins
-    display->init(240, 240, SPI_MODE2);
+    display->init(width, height, SPI_MODE2);
   } else {
-    display->init();
+    display->init(width, height);
   }
+  // Only send the areas of the frame buffer that the renderer touched
+  display->updateChangedAreasOnly(true);
   display->setRotation(config.rotation);
   if (config.mirror) {
     const std::array<uint8_t, 4> mirrorTFT{0x80, 0x20, 0x40, 0xE0}; // Mirror + rotate
@@ -37,6 +58,30 @@ ST7789_Display::ST7789_Display(const ST7789_Config &config) :
     } else {
       Serial.println(F("OK"));
     }
+    if (config.doubleBuffer && config.asyncUpdates && eyeSized) {
+      Serial.print(displayNum);
+      Serial.print(F(": doubleBuffer "));
+      Serial.println(doubleBuffer.begin(display) ? F("OK") : F("failed"));
+    }
+  }
+  // Go by whether the frame buffer exists rather than what was asked for, since allocating it can fail
+  const bool hasFrameBuffer = display->getFrameBuffer() != nullptr;
+  interlace = config.interlace && hasFrameBuffer && !config.asyncUpdates && eyeSized;
+  if ((config.interlace && !interlace) || (config.doubleBuffer && !eyeSized)) {
+    Serial.println(F("Interlacing and double buffering need a 240x240 panel with a frame buffer"));
+  }
+  if (config.asyncUpdates && !hasFrameBuffer) {
+    Serial.println(F("Async updates need a frame buffer, drawing synchronously"));
+  }
+  if (config.asyncUpdates && hasFrameBuffer) {
+    bus = sharedBus(config.sck);
+    const int slot = bus ? bus->attach(this) : -1;
+    if (slot < 0) {
+      Serial.println(F("Too many displays for the SPI bus, async updates disabled"));
+      bus = nullptr;
+    } else {
+      busSlot = slot;
+    }
   }
   Serial.println(F("Success"));
   this->displayNum = displayNum;
@@ -52,10 +97,34 @@ ST7789_Display::~ST7789_Display() {
 
 void ST7789_Display::drawPixel(int16_t x, int16_t y, uint16_t color565) {
   display->drawPixel(x, y, color565);
+  doubleBuffer.touch(y, 1);
 }
 
 void ST7789_Display::drawFastVLine(int16_t x, int16_t y, int16_t height, uint16_t color565) {
   display->drawFastVLine(x, y, height, color565);
+  doubleBuffer.touch(y, height);
+}
+
+void ST7789_Display::writeColumn(int16_t x, int16_t y, int16_t height, const uint16_t *colors565) {
+  // writeRect() clips once for the whole run and copies straight into the frame buffer (when
+  // enabled), updating the changed area as it goes.
+  display->writeRect(x, y, 1, height, colors565);
+  doubleBuffer.touch(y, height);
+}
+
+void ST7789_Display::writeSpan(int16_t x, int16_t y, int16_t width, const uint16_t *colors565) {
+  display->writeRect(x, y, width, 1, colors565);
+  doubleBuffer.touch(y, 1);
+}
+
+void ST7789_Display::writeRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t *colors565) {
+  // Without a frame buffer, this sets the display's address window once and streams the pixels straight out
+  display->writeRect(x, y, width, height, colors565);
+  doubleBuffer.touch(y, height);
+}
+
+uint16_t *ST7789_Display::frameBuffer() {
+  return display->getFrameBuffer();
 }
 
 void ST7789_Display::drawText(int16_t x, int16_t y, char *text) {
@@ -63,9 +132,11 @@ void ST7789_Display::drawText(int16_t x, int16_t y, char *text) {
   display->setTextSize(2);
   display->setTextColor(ST77XX_WHITE, ST77XX_BLACK);
   display->print(text);
+  // Text can wrap, so assume it could have touched any row below where it started
+  doubleBuffer.touch(y, 240 - y);
 }
 
-void ST7789_Display::update() {
+void ST7789_Display::update(const ChangedRows &changed) {
 
 #ifdef SHOW_FPS
   // A per-display FPS counter
@@ -77,19 +148,67 @@ void ST7789_Display::update() {
   display->setTextSize(2);
   display->setTextColor(ST77XX_WHITE, ST77XX_BLACK);
   display->drawNumber(fps, 110, 110);
+  if (interlace) {
+    // Each update is only one field, so mark the count as fields per second
+    display->setCursor(110 + 12 * (fps > 99 ? 3 : fps > 9 ? 2 : 1), 110);
+    display->print("i");
+  }
+  doubleBuffer.touch(110, 16);
   framesDrawn++;
+  // The counter has to go out along with whatever else changed
+  ChangedRows rows = changed;
+  for (uint32_t y = 110; y < 126; y++) {
+    rows.addRow(y, 110, 170);
+  }
+#else
+  const ChangedRows &rows = changed;
 #endif
 
-  if (asyncUpdates) {
-    if (!display->updateScreenAsync()) {
-      Serial.print(F("updateScreenAsync() failed for display "));
-      Serial.println(displayNum);
-    }
+  if (bus) {
+    // Sent as soon as the bus is free, which may be straight away
+    bus->enqueue(busSlot);
+  } else if (display->getFrameBuffer() && eyeSized) {
+    // Only the parts of the frame that changed are sent, each as its own address window
+    sendChangedRows(display, interlace ? fields.next(rows) : rows);
+    sinceUpdate = 0;
   } else {
     display->updateScreen();
   }
 }
 
-bool ST7789_Display::isAvailable() const {
+bool ST7789_Display::isAvailable() {
+  if (bus) {
+    bus->poll();
+    if (bus->isQueued(busSlot)) {
+      return false;
+    }
+    // With double buffering, the back buffer can be drawn on while the front one is still being sent
+    return doubleBuffer.enabled() || !display->asyncUpdateActive();
+  }
+  if (interlace && sinceUpdate > interlaceFlushMs && fields.pending()) {
+    // Nothing has changed for a while, so send the rows that were held back rather than leave them stale
+    sendChangedRows(display, fields.next(ChangedRows{}));
+    sinceUpdate = 0;
+  }
   return !display->asyncUpdateActive();
 }
+
+void ST7789_Display::startTransfer() {
+  const bool started = doubleBuffer.enabled() ? doubleBuffer.send() : display->updateScreenAsync();
+  if (!started) {
+    Serial.print(F("updateScreenAsync() failed for display "));
+    Serial.println(displayNum);
+  }
+}
+
+int16_t ST7789_Display::width() const {
+  return display->width();
+}
+
+int16_t ST7789_Display::height() const {
+  return display->height();
+}
+
+bool ST7789_Display::transferActive() const {
+  return display->asyncUpdateActive();
+}
@@ -4,6 +4,8 @@
 #include <array>
 
 #include "Display.h"
+#include "DoubleBuffer.h"
+#include "SharedBus.h"
 
 typedef struct {
   int8_t cs;           // Chip select pin, or -1.
@@ -15,13 +17,26 @@ typedef struct {
   bool mirror;          // Mirror the display in the X direction.
   bool useFrameBuffer;  // Whether to use frame buffering.
   bool asyncUpdates;    // Whether to update the screen asynchronously (for better performance).
+  bool doubleBuffer;    // Whether to draw the next frame while the last is sent (needs ~115KB more RAM).
+  bool interlace;       // Whether to send alternate rows on alternate updates (needs a frame buffer, not async).
+  uint16_t width;       // The panel's native width (at rotation 0), or 0 for 240.
+  uint16_t height;      // The panel's native height (at rotation 0), or 0 for 240.
 } ST7789_Config;
 
 class ST7789_Display : public Display<ST7789_Display> {
 private:
   ST7789_t3* display;
-  bool asyncUpdates;
   int displayNum;
+  /// Whether the panel is the size of a single eye. Larger panels are shared between eyes using Viewports.
+  bool eyeSized{};
+  DoubleBuffer<ST7789_t3> doubleBuffer{};
+  /// The SPI bus this display takes turns on when updating asynchronously
+  SharedBus<ST7789_Display> *bus{};
+  size_t busSlot{};
+  /// Set when sending alternate rows on alternate updates
+  bool interlace{};
+  InterlacedRows fields{};
+  elapsedMillis sinceUpdate{};
 
 #ifdef SHOW_FPS
   uint32_t framesDrawn{};
@@ -30,7 +45,8 @@ private:
 #endif
 
 public:
-  /// Creates a generic wrapper for a 240x240 ST7789 TFT display screen.
+  /// Creates a generic wrapper for an ST7789 TFT display screen. This is normally 240x240, but can be a
+  /// larger panel that shows both eyes through a Viewport each.
   /// \param config the screen's configuration.
   ST7789_Display(const ST7789_Config &config);
 
@@ -40,9 +56,29 @@ public:
 
   void drawFastVLine(int16_t x, int16_t y, int16_t height, uint16_t color565);
 
+  void writeColumn(int16_t x, int16_t y, int16_t height, const uint16_t *colors565);
+
+  void writeSpan(int16_t x, int16_t y, int16_t width, const uint16_t *colors565);
+
+  void writeRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t *colors565);
+
+  uint16_t *frameBuffer();
+
   void drawText(int16_t x, int16_t y, char *text);
 
-  void update();
+  void update(const ChangedRows &changed);
+
+  bool isAvailable();
+
+  /// \return the width of the panel as drawn on, after rotation.
+  int16_t width() const;
+
+  /// \return the height of the panel as drawn on, after rotation.
+  int16_t height() const;
+
+  /// Starts sending the frame buffer to the display asynchronously. Called by the bus when it's our turn.
+  void startTransfer();
 
-  bool isAvailable() const;
+  /// \return true if a frame is still being sent to the display.
+  bool transferActive() const;
 };
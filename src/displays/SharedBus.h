@@ -0,0 +1,72 @@
+#pragma once
+
+#include <Arduino.h>
+#include <array>
+
+/// Arbitrates an SPI bus between the displays connected to it. Each display queues its frame when it's
+/// ready, and the frames are sent one at a time, taking turns between the displays. The next transfer is
+/// started as soon as the previous one finishes, by whichever display next polls the bus, so a display that
+/// isn't being polled doesn't hold the others up. A display with a bus of its own behaves just as it would
+/// without one.
+/// \tparam Device the type of device on the bus. It must provide startTransfer(), which starts sending its
+/// queued frame asynchronously, and transferActive(), which says whether that is still happening.
+/// \tparam maxDevices the most devices that can share the bus.
+template<typename Device, size_t maxDevices = 6>
+class SharedBus {
+private:
+  std::array<Device *, maxDevices> devices{};
+  std::array<bool, maxDevices> queued{};
+  size_t count{};
+  /// The device whose transfer was started last, or maxDevices if there isn't one
+  size_t active{maxDevices};
+  /// The device that gets the first chance at the bus next time, so they all take turns
+  size_t turn{};
+
+public:
+  /// Adds a device to the bus.
+  /// \param device the device to add.
+  /// \return the device's slot on the bus, or -1 if the bus is full.
+  int attach(Device *device) {
+    if (count == maxDevices) {
+      return -1;
+    }
+    devices[count] = device;
+    return static_cast<int>(count++);
+  }
+
+  /// \return the number of devices on the bus.
+  size_t size() const {
+    return count;
+  }
+
+  /// Queues a transfer for a device, and starts it straight away if the bus is free.
+  /// \param slot the device's slot on the bus.
+  void enqueue(size_t slot) {
+    queued[slot] = true;
+    poll();
+  }
+
+  /// \param slot the device's slot on the bus.
+  /// \return true if the device has a transfer waiting for the bus.
+  bool isQueued(size_t slot) const {
+    return queued[slot];
+  }
+
+  /// Starts the next queued transfer if the bus has become free. Call this often.
+  void poll() {
+    if (active < count && devices[active]->transferActive()) {
+      return;
+    }
+    active = maxDevices;
+    for (size_t n = 0; n < count; n++) {
+      const size_t i = (turn + n) % count;
+      if (queued[i]) {
+        queued[i] = false;
+        active = i;
+        turn = (i + 1) % count;
+        devices[i]->startTransfer();
+        return;
+      }
+    }
+  }
+};
@@ -0,0 +1,118 @@
+#include <EEPROM.h>
+#include <SPI.h>
+
+#include "SpiCalibration.h"
+
+namespace {
+
+/// The slowest clock speed to search, in Hz
+constexpr uint32_t slowestClock{4'000'000};
+
+/// How many times each test pattern has to arrive intact for a clock speed to count as working
+constexpr uint8_t trialsPerPattern{8};
+
+/// Where the calibrated speeds are kept in EEPROM, one record per SPI port
+constexpr int calibrationAddress{0};
+constexpr uint32_t calibrationMagic{0x53504943}; // "SPIC"
+
+struct SavedClock {
+  uint32_t magic;
+  int8_t mosi;
+  int8_t sck;
+  uint32_t hz;
+};
+
+struct Port {
+  SPIClass *spi;
+  int8_t miso;
+  int slot;
+};
+
+/// \return the Teensy 4 SPI port that a display's SCK pin belongs to, with the MISO pin that the loopback
+/// wire goes to, or a null port if it isn't one that can be calibrated.
+Port portFor(int8_t sck) {
+  switch (sck) {
+    case 13:
+      return {&SPI, 12, 0};
+    case 27:
+      return {&SPI1, 1, 1};
+    default:
+      return {nullptr, -1, -1};
+  }
+}
+
+/// Sends a set of test patterns around the loopback at the given speed.
+/// \return true if every pattern came back exactly as it was sent.
+bool loopbackWorks(SPIClass &spi, uint32_t hz) {
+  uint8_t sent[256], received[256];
+  uint32_t seed{0x9E3779B9};
+  for (uint8_t pattern = 0; pattern < 6; pattern++) {
+    for (size_t i = 0; i < sizeof(sent); i++) {
+      switch (pattern) {
+        case 0: sent[i] = 0x00; break;
+        case 1: sent[i] = 0xFF; break;
+        case 2: sent[i] = 0xAA; break;
+        case 3: sent[i] = 0x55; break;
+        case 4: sent[i] = 1 << (i & 7); break;
+        default:
+          // Pseudo-random data catches problems that depend on what was sent just before
+          seed ^= seed << 13;
+          seed ^= seed >> 17;
+          seed ^= seed << 5;
+          sent[i] = seed;
+          break;
+      }
+    }
+    for (uint8_t trial = 0; trial < trialsPerPattern; trial++) {
+      spi.beginTransaction(SPISettings(hz, MSBFIRST, SPI_MODE0));
+      spi.transfer(sent, received, sizeof(sent));
+      spi.endTransaction();
+      if (memcmp(sent, received, sizeof(sent)) != 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}
+
+uint32_t calibratedSpiSpeed(int8_t cs, int8_t mosi, int8_t sck, uint32_t fallback, bool recalibrate,
+                            uint32_t maxHz) {
+  const Port port = portFor(sck);
+  if (!port.spi || cs < 0) {
+    // Without a CS pin the display would take the test patterns as commands
+    Serial.println(F("SPI calibration needs a CS pin on SPI or SPI1, using the default speed"));
+    return fallback;
+  }
+
+  const int address = calibrationAddress + port.slot * static_cast<int>(sizeof(SavedClock));
+  SavedClock saved{};
+  EEPROM.get(address, saved);
+  if (!recalibrate && saved.magic == calibrationMagic && saved.mosi == mosi && saved.sck == sck && saved.hz &&
+      saved.hz <= maxHz) {
+    Serial.print(F("Using saved SPI speed "));
+    Serial.println(saved.hz);
+    return saved.hz;
+  }
+
+  pinMode(cs, OUTPUT);
+  digitalWrite(cs, HIGH);
+  port.spi->setMOSI(mosi);
+  port.spi->setMISO(port.miso);
+  port.spi->setSCK(sck);
+  port.spi->begin();
+  const uint32_t hz = findFastestClock([&](uint32_t hz) { return loopbackWorks(*port.spi, hz); },
+                                       slowestClock, maxHz);
+  port.spi->end();
+
+  if (!hz) {
+    Serial.println(F("SPI calibration failed, is MOSI looped back to MISO? Using the default speed"));
+    return fallback;
+  }
+  Serial.print(F("Calibrated SPI speed "));
+  Serial.println(hz);
+  saved = {calibrationMagic, mosi, sck, hz};
+  EEPROM.put(address, saved);
+  return hz;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+
+/// The calibrated clock is this much slower than the fastest one that worked, to leave some headroom
+/// for temperature and other changes after calibration.
+constexpr uint32_t calibrationMarginPercent{15};
+
+/// The fastest SPI clock calibration will ever choose. The displays themselves start to corrupt at around
+/// 100MHz (see SPI_SPEED in config.h), which a loopback test can't detect.
+constexpr uint32_t displaySafeClock{90'000'000};
+
+/// Finds the fastest clock that a link works at, by binary search. It's assumed that if the link works
+/// at one speed then it works at every slower speed too.
+/// \param works called with a clock speed in Hz, returns true if the link worked reliably at that speed.
+/// \param minHz the slowest speed to consider.
+/// \param maxHz the fastest speed to consider.
+/// \param stepHz how close the search needs to get to the fastest working speed.
+/// \return maxHz if the link worked at that speed, otherwise the fastest working speed less the safety
+/// margin, or 0 if the link didn't work even at minHz.
+template<typename Probe>
+uint32_t findFastestClock(Probe &&works, uint32_t minHz, uint32_t maxHz, uint32_t stepHz = 1'000'000) {
+  if (!works(minHz)) {
+    return 0;
+  }
+  if (works(maxHz)) {
+    // The link is faster than anything we'd use, so maxHz already has plenty of headroom
+    return maxHz;
+  }
+  uint32_t good = minHz;
+  uint32_t bad = maxHz;
+  while (bad - good > stepHz) {
+    const uint32_t mid = good + (bad - good) / 2;
+    if (works(mid)) {
+      good = mid;
+    } else {
+      bad = mid;
+    }
+  }
+  return std::max(minHz, good / 100 * (100 - calibrationMarginPercent));
+}
+
+/// Works out the fastest SPI clock a display can be driven at. Since the displays can't be read back,
+/// this sends test patterns around a wire looped from the port's MOSI pin back to its MISO pin (12 for
+/// SPI, 1 for SPI1) and checks that they arrive intact. The result is saved in EEPROM and reused after
+/// that, so the loopback wire is only needed the first time.
+/// The loopback only tests the Teensy's own pins, not the cable to the display or the display's controller,
+/// so the result is only an upper bound. That's why it never goes above maxHz.
+/// \param cs the display's chip select pin. It's held high throughout so the display ignores the patterns.
+/// \param mosi the display's MOSI pin.
+/// \param sck the display's SCK pin.
+/// \param fallback the speed to use if calibration isn't possible.
+/// \param recalibrate true to ignore any saved result and calibrate again.
+/// \param maxHz the fastest speed the display is known to cope with.
+/// \return the speed to drive the display at.
+uint32_t calibratedSpiSpeed(int8_t cs, int8_t mosi, int8_t sck, uint32_t fallback, bool recalibrate = false,
+                            uint32_t maxHz = displaySafeClock);
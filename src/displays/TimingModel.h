@@ -0,0 +1,255 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+#include <array>
+
+#include "ChangedRows.h"
+#include "Display.h"
+
+/// Simulated time, shared by the CPU and any TimingModelDisplays. Time only moves on when advance() is
+/// called, so the same configuration always gives the same prediction.
+class TimingClock {
+public:
+  /// The current simulated time, in nanoseconds
+  uint64_t nowNs{};
+  /// How long the CPU has spent waiting for a display to become free
+  uint64_t idleNs{};
+  /// The CPU time taken by each pass of the main loop, besides drawing
+  uint32_t loopNs{2'000};
+  /// When the SPI bus shared by displays with sharedBus set will have sent everything queued on it
+  uint64_t sharedBusyUntil{};
+
+  void advance(uint64_t ns) {
+    nowNs += ns;
+  }
+
+  uint32_t millis() const {
+    return static_cast<uint32_t>(nowNs / 1'000'000);
+  }
+};
+
+/// The costs a TimingModelDisplay charges for drawing and sending. The defaults are rough figures for a
+/// Teensy 4.0 driving a GC9A01A, and are worth adjusting to match measurements from real hardware.
+struct TimingModelConfig {
+  uint32_t spiHz{30'000'000};      // The SPI clock speed.
+  uint8_t bitsPerPixel{16};        // 16 for 565, 12 for RGB444.
+  bool useFrameBuffer{true};       // Whether to draw into a frame buffer, or straight to the screen.
+  bool asyncUpdates{true};         // Whether the frame buffer is sent by DMA while the CPU carries on.
+  bool doubleBuffer{false};        // Whether the next frame can be drawn while the last is sent (needs async).
+  bool changedRowsOnly{true};      // Whether synchronous updates send just the changed rows, or their bounding box.
+  bool interlace{false};           // Whether synchronous updates send alternate rows on alternate updates.
+  bool sharedBus{false};           // Whether async updates take turns on one SPI bus with the other displays.
+  uint32_t commandNs{500};         // The CS/DC toggling and FIFO draining around each command sent.
+  uint32_t dmaSetupNs{5'000};      // The CPU time taken to start an asynchronous transfer.
+  uint32_t renderNsPerPixel{40};   // The CPU time taken to work out each pixel that gets drawn.
+};
+
+/// A display that draws nothing, but keeps track of how long the drawing and sending would have taken on
+/// real hardware. With a host build of the EyeController, this predicts the frame rate and CPU load of a
+/// configuration without needing the hardware. Each display has an SPI port to itself, unless sharedBus is
+/// set. Then its async transfers queue behind those of the other displays that share, in the order they
+/// were started, much like SharedBus. Synchronous sends block the CPU, so they never overlap anyway.
+class TimingModelDisplay : public Display<TimingModelDisplay> {
+private:
+  TimingClock &clock;
+  TimingModelConfig config;
+  InterlacedRows fields{};
+  /// When the transfer currently being sent (or queued behind it) started, and when it will finish
+  uint64_t lastStart{};
+  uint64_t busyUntil{};
+
+  /// \return the time taken to send the given number of bytes.
+  uint64_t bytesNs(uint64_t bytes) const {
+    return bytes * 8 * 1'000'000'000 / config.spiHz;
+  }
+
+  /// Records sending a rectangle of pixels as an address window (CASET, RASET and RAMWR).
+  /// \return the time taken to send it.
+  uint64_t sendWindow(uint32_t pixels) {
+    const uint64_t commandBytes = 11;
+    const uint64_t pixelBytes = (static_cast<uint64_t>(pixels) * config.bitsPerPixel + 7) / 8;
+    windows++;
+    bytesSent += commandBytes + pixelBytes;
+    return 3 * config.commandNs + bytesNs(commandBytes + pixelBytes);
+  }
+
+  /// Charges the CPU for drawing some pixels. Without a frame buffer, they also go straight to the screen.
+  void draw(uint32_t pixels) {
+    clock.advance(static_cast<uint64_t>(pixels) * config.renderNsPerPixel);
+    if (!config.useFrameBuffer) {
+      sendBlocking(sendWindow(pixels));
+    }
+  }
+
+  void sendBlocking(uint64_t ns) {
+    lastStart = clock.nowNs;
+    clock.advance(ns);
+    busyUntil = clock.nowNs;
+    busyNs += ns;
+  }
+
+public:
+  /// The number of updates (frames) sent
+  uint32_t updates{};
+  /// The number of address windows sent
+  uint32_t windows{};
+  /// The number of bytes sent, including commands
+  uint64_t bytesSent{};
+  /// How long the SPI link has spent sending
+  uint64_t busyNs{};
+
+  /// \param clock the simulated time, shared with the other displays.
+  /// \param config the costs to charge.
+  TimingModelDisplay(TimingClock &clock, const TimingModelConfig &config) : clock(clock), config(config) {
+    this->config.asyncUpdates = config.asyncUpdates && config.useFrameBuffer;
+    this->config.doubleBuffer = config.doubleBuffer && this->config.asyncUpdates;
+    this->config.sharedBus = config.sharedBus && this->config.asyncUpdates;
+  }
+
+  void drawPixel(int16_t, int16_t, uint16_t) {
+    draw(1);
+  }
+
+  void drawFastVLine(int16_t, int16_t, int16_t height, uint16_t) {
+    draw(height);
+  }
+
+  void writeColumn(int16_t, int16_t, int16_t height, const uint16_t *) {
+    draw(height);
+  }
+
+  void writeSpan(int16_t, int16_t, int16_t width, const uint16_t *) {
+    draw(width);
+  }
+
+  void writeRect(int16_t, int16_t, int16_t width, int16_t height, const uint16_t *) {
+    draw(static_cast<uint32_t>(width) * height);
+  }
+
+  uint16_t *frameBuffer() {
+    return nullptr;
+  }
+
+  void drawText(int16_t, int16_t, char *) {}
+
+  void update(const ChangedRows &changed) {
+    updates++;
+    if (!config.useFrameBuffer) {
+      // Everything was sent as it was drawn
+      return;
+    }
+    if (config.asyncUpdates) {
+      // The libraries' DMA always sends the whole frame buffer. With double buffering this frame is
+      // queued behind the one being sent, otherwise the display wasn't available until that finished.
+      clock.advance(config.dmaSetupNs);
+      const uint64_t ns = sendWindow(ChangedRows::width * ChangedRows::height);
+      lastStart = std::max(clock.nowNs, config.sharedBus ? std::max(busyUntil, clock.sharedBusyUntil) : busyUntil);
+      busyUntil = lastStart + ns;
+      busyNs += ns;
+      if (config.sharedBus) {
+        clock.sharedBusyUntil = busyUntil;
+      }
+      return;
+    }
+    const ChangedRows &rows = config.interlace ? fields.next(changed) : changed;
+    uint64_t ns = 0;
+    if (config.changedRowsOnly) {
+      rows.forEachRect([&](uint32_t, uint32_t, uint32_t w, uint32_t h) { ns += sendWindow(w * h); });
+    } else {
+      uint32_t minX = ChangedRows::width, maxX = 0, minY = ChangedRows::height, maxY = 0;
+      for (uint32_t y = 0; y < ChangedRows::height; y++) {
+        if (rows.end[y]) {
+          minX = std::min<uint32_t>(minX, rows.start[y]);
+          maxX = std::max<uint32_t>(maxX, rows.end[y]);
+          minY = std::min(minY, y);
+          maxY = y + 1;
+        }
+      }
+      if (maxY) {
+        ns = sendWindow((maxX - minX) * (maxY - minY));
+      }
+    }
+    sendBlocking(ns);
+  }
+
+  bool isAvailable() {
+    if (config.interlace && fields.pending() && clock.nowNs >= busyUntil &&
+        clock.nowNs - busyUntil > static_cast<uint64_t>(interlaceFlushMs) * 1'000'000) {
+      // The eye has stopped changing, so send the rows that were held back
+      uint64_t ns = 0;
+      fields.next(ChangedRows{}).forEachRect([&](uint32_t, uint32_t, uint32_t w, uint32_t h) {
+        ns += sendWindow(w * h);
+      });
+      sendBlocking(ns);
+    }
+    return clock.nowNs >= readyAt();
+  }
+
+  /// \return the simulated time at which the display can next be drawn on.
+  uint64_t readyAt() const {
+    // A double buffered display is free once its queued frame has started sending
+    return config.doubleBuffer ? lastStart : busyUntil;
+  }
+};
+
+/// What a run of the timing model predicts.
+struct TimingReport {
+  float fps;             // Frames per second per display, on average.
+  float cpuIdlePercent;  // How much of the time the CPU was waiting for a display to become free.
+  float linkPercent;     // How much of the time the displays' SPI links were sending, on average.
+};
+
+/// Runs an EyeController against TimingModelDisplays for a stretch of simulated time.
+/// \param eyes the controller, drawing on the given displays.
+/// \param clock the clock the displays were created with.
+/// \param displays the displays the controller draws on.
+/// \param durationMs how long to run for, in simulated milliseconds.
+/// \param tick called with the simulated time in milliseconds before every frame, so that the
+/// controller's time can be kept in step with the clock, e.g. by setting its SimulatedTiming's nowMs.
+/// \return the predicted frame rate and load.
+template<typename Controller, size_t numDisplays, typename Tick>
+TimingReport runTimingModel(Controller &eyes, TimingClock &clock,
+                            const std::array<TimingModelDisplay *, numDisplays> &displays, uint32_t durationMs,
+                            Tick &&tick) {
+  const uint64_t start = clock.nowNs;
+  const uint64_t end = start + static_cast<uint64_t>(durationMs) * 1'000'000;
+  const uint64_t idleAtStart = clock.idleNs;
+  std::array<uint32_t, numDisplays> updatesAtStart{};
+  std::array<uint64_t, numDisplays> busyAtStart{};
+  for (size_t i = 0; i < numDisplays; i++) {
+    updatesAtStart[i] = displays[i]->updates;
+    busyAtStart[i] = displays[i]->busyNs;
+  }
+
+  while (clock.nowNs < end) {
+    tick(clock.millis());
+    clock.advance(clock.loopNs);
+    if (!eyes.renderFrame()) {
+      // Every display is busy, so wait for the first to come free
+      uint64_t next = end;
+      for (auto display: displays) {
+        if (display->readyAt() > clock.nowNs) {
+          next = std::min(next, display->readyAt());
+        }
+      }
+      if (next > clock.nowNs) {
+        clock.idleNs += next - clock.nowNs;
+        clock.nowNs = next;
+      }
+    }
+  }
+
+  const double elapsedNs = static_cast<double>(clock.nowNs - start);
+  uint64_t updates = 0, busy = 0;
+  for (size_t i = 0; i < numDisplays; i++) {
+    updates += displays[i]->updates - updatesAtStart[i];
+    busy += displays[i]->busyNs - busyAtStart[i];
+  }
+  return TimingReport{
+      static_cast<float>(updates / static_cast<double>(numDisplays) / (elapsedNs / 1e9)),
+      static_cast<float>(100.0 * (clock.idleNs - idleAtStart) / elapsedNs),
+      // Frames queued behind the last one can run past the end, so this is capped
+      static_cast<float>(std::min(100.0, 100.0 * busy / numDisplays / elapsedNs)),
+  };
+}
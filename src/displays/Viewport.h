@@ -0,0 +1,210 @@
+#pragma once
+
+#include <Arduino.h>
+#include <algorithm>
+#include <array>
+
+#include "Display.h"
+
+/// One eye's part of a panel that is shared between several eyes. The eye draws into its viewport just as it
+/// would onto a screen of its own, and the viewport moves everything into place on the panel, clipping it to
+/// the area the viewport has been given. If that area is smaller than the eye, the viewport can shrink the eye
+/// to fit, by only passing on the pixels nearest to each of the panel's. The panel is only sent to the screen
+/// once every viewport on it has drawn a frame, so all the eyes go out in a single transfer.
+/// \tparam Panel the Display implementation for the panel.
+template<typename Panel>
+class Viewport : public Display<Viewport<Panel>> {
+public:
+  /// The width and height of an eye
+  static constexpr int16_t eyeWidth{240};
+
+private:
+  /// Bookkeeping shared by all the viewports of a panel
+  struct Shared {
+    /// The number of viewports ever created on the panel, which hands out their bits
+    uint32_t viewports{};
+    /// The number of viewports still alive, so the last one can free this
+    uint32_t alive{};
+    uint32_t drawn{};
+  };
+
+  Panel *panel;
+  Shared *shared;
+  uint32_t bit;
+  /// Where the eye's top left corner goes on the panel
+  int16_t originX, originY;
+  /// The area of the panel the viewport may draw on
+  int16_t clipLeft, clipTop, clipRight, clipBottom;
+  /// Whether to mirror the eye in the X direction. This stands in for the mirroring that a display of
+  /// its own would do in hardware.
+  bool mirror;
+  /// The width and height the eye is drawn at on the panel, no more than eyeWidth
+  int16_t size;
+
+  /// \return the eye pixel shown at a panel pixel, relative to the eye's origin. It's the one under the
+  /// middle of the panel pixel, so a shrunk eye keeps both of its edges and looks the same mirrored.
+  int16_t unscaled(int16_t v) const {
+    return static_cast<int16_t>((2 * v + 1) * eyeWidth / (2 * size));
+  }
+
+  /// \return the first panel pixel, relative to the eye's origin, that shows an eye pixel at or after v.
+  int16_t scaled(int16_t v) const {
+    return static_cast<int16_t>((2 * v * size + eyeWidth - 1) / (2 * eyeWidth));
+  }
+
+  /// Works out which panel columns show a run of eye columns, once it has been mirrored, scaled and clipped.
+  /// \param x the first column of the run, relative to the eye.
+  /// \param w the number of columns in the run.
+  /// \param left receives the first panel column.
+  /// \param right receives the panel column after the last.
+  /// \return true if any of the run is shown.
+  bool panelColumns(int16_t x, int16_t w, int16_t &left, int16_t &right) const {
+    const int16_t first = mirror ? eyeWidth - x - w : x;
+    left = std::max<int16_t>(originX + scaled(first), clipLeft);
+    right = std::min<int16_t>(originX + scaled(first + w), clipRight);
+    return left < right;
+  }
+
+  /// Works out which panel rows show a run of eye rows, once it has been scaled and clipped.
+  /// \return true if any of the run is shown.
+  bool panelRows(int16_t y, int16_t h, int16_t &top, int16_t &bottom) const {
+    top = std::max<int16_t>(originY + scaled(y), clipTop);
+    bottom = std::min<int16_t>(originY + scaled(y + h), clipBottom);
+    return top < bottom;
+  }
+
+  /// \return the eye column shown at a panel column.
+  int16_t eyeColumn(int16_t panelX) const {
+    const int16_t x = unscaled(panelX - originX);
+    return mirror ? eyeWidth - 1 - x : x;
+  }
+
+  /// \return the eye row shown at a panel row.
+  int16_t eyeRow(int16_t panelY) const {
+    return unscaled(panelY - originY);
+  }
+
+public:
+  /// Creates a viewport onto a panel.
+  /// \param panel the panel to draw on.
+  /// \param previous another viewport already on the same panel, or nullptr if this is the first.
+  /// \param originX the panel column that the eye's left edge goes at. This can be off the panel.
+  /// \param originY the panel row that the eye's top edge goes at. This can be off the panel.
+  /// \param clipLeft the first panel column the viewport may draw on.
+  /// \param clipTop the first panel row the viewport may draw on.
+  /// \param clipWidth the number of panel columns the viewport may draw on.
+  /// \param clipHeight the number of panel rows the viewport may draw on.
+  /// \param mirror true to mirror the eye in the X direction.
+  /// \param size the width and height to draw the eye at on the panel. Less than eyeWidth shrinks the eye.
+  Viewport(Panel *panel, Viewport *previous, int16_t originX, int16_t originY, int16_t clipLeft, int16_t clipTop,
+           int16_t clipWidth, int16_t clipHeight, bool mirror, int16_t size = eyeWidth) :
+      panel(panel), shared(previous ? previous->shared : new Shared{}), originX(originX), originY(originY),
+      clipLeft(clipLeft), clipTop(clipTop), clipRight(clipLeft + clipWidth), clipBottom(clipTop + clipHeight),
+      mirror(mirror), size(std::min(std::max<int16_t>(size, 1), eyeWidth)) {
+    bit = 1 << shared->viewports++;
+    shared->alive++;
+  }
+
+  Viewport(const Viewport &) = delete;
+  Viewport &operator=(const Viewport &) = delete;
+
+  ~Viewport() {
+    if (--shared->alive == 0) {
+      delete shared;
+    }
+  }
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color565) {
+    drawFastVLine(x, y, 1, color565);
+  }
+
+  void drawFastVLine(int16_t x, int16_t y, int16_t height, uint16_t color565) {
+    int16_t left, right, top, bottom;
+    if (panelColumns(x, 1, left, right) && panelRows(y, height, top, bottom)) {
+      panel->drawFastVLine(left, top, bottom - top, color565);
+    }
+  }
+
+  void writeColumn(int16_t x, int16_t y, int16_t height, const uint16_t *colors565) {
+    int16_t left, right, top, bottom;
+    if (!panelColumns(x, 1, left, right) || !panelRows(y, height, top, bottom)) {
+      return;
+    }
+    if (size == eyeWidth) {
+      panel->writeColumn(left, top, bottom - top, colors565 + (top - y - originY));
+      return;
+    }
+    uint16_t column[eyeWidth];
+    for (int16_t panelY = top; panelY < bottom; panelY++) {
+      column[panelY - top] = colors565[eyeRow(panelY) - y];
+    }
+    panel->writeColumn(left, top, bottom - top, column);
+  }
+
+  void writeSpan(int16_t x, int16_t y, int16_t width, const uint16_t *colors565) {
+    int16_t left, right, top, bottom;
+    if (!panelColumns(x, width, left, right) || !panelRows(y, 1, top, bottom)) {
+      return;
+    }
+    if (!mirror && size == eyeWidth) {
+      panel->writeSpan(left, top, right - left, colors565 + (left - originX - x));
+      return;
+    }
+    // Mirrored runs go onto the panel right to left, and shrunk ones skip the pixels that aren't shown
+    uint16_t span[eyeWidth];
+    for (int16_t panelX = left; panelX < right; panelX++) {
+      span[panelX - left] = colors565[eyeColumn(panelX) - x];
+    }
+    panel->writeSpan(left, top, right - left, span);
+  }
+
+  void writeRect(int16_t x, int16_t y, int16_t width, int16_t height, const uint16_t *colors565) {
+    for (int16_t row = 0; row < height; row++) {
+      writeSpan(x, y + row, width, colors565 + row * width);
+    }
+  }
+
+  /// \return nullptr, since the panel's frame buffer isn't laid out like a screen of the eye's own.
+  uint16_t *frameBuffer() {
+    return nullptr;
+  }
+
+  void drawText(int16_t x, int16_t y, char *text) {
+    panel->drawText(originX + scaled(x), originY + scaled(y), text);
+  }
+
+  void update(const ChangedRows &) {
+    // If this viewport already has a frame waiting, the panel goes out now rather than waiting for the
+    // others, so that a viewport whose eye isn't changing can't hold the rest up
+    if (!(shared->drawn & bit)) {
+      shared->drawn |= bit;
+      if (shared->drawn != (1u << shared->viewports) - 1) {
+        return;
+      }
+    }
+    panel->update(ChangedRows{});
+    shared->drawn = 0;
+  }
+
+  bool isAvailable() {
+    return panel->isAvailable();
+  }
+};
+
+/// Shares a panel between two eyes, side by side. Each eye gets half of the panel, and is drawn centred in it,
+/// shrunk if need be so that the whole eye fits.
+/// \param panel the panel to draw on.
+/// \param width the width of the panel, as it is after rotation.
+/// \param height the height of the panel, as it is after rotation.
+/// \param mirrorLeft true to mirror the left eye in the X direction.
+/// \return the viewports for the left and right eyes.
+template<typename Panel>
+std::array<Viewport<Panel> *, 2> splitPanel(Panel *panel, int16_t width, int16_t height, bool mirrorLeft) {
+  const int16_t half = width / 2;
+  const int16_t size = std::min({half, height, Viewport<Panel>::eyeWidth});
+  const int16_t left = (half - size) / 2;
+  const int16_t top = (height - size) / 2;
+  auto l = new Viewport<Panel>(panel, nullptr, left, top, 0, 0, half, height, mirrorLeft, size);
+  auto r = new Viewport<Panel>(panel, l, half + left, top, half, 0, width - half, height, false, size);
+  return {l, r};
+}
@@ -4,16 +4,72 @@
 #include <vector>
 #include <memory>
 #include <cmath>
+#include <new>
 #include "eyes.h"
+#include "Timing.h"
+#include "../displays/ChangedRows.h"
+#include "../util/profiler.h"
+#ifdef RENDER_PAIRS
+#include "../util/simd.h"
+#endif
+
+// Render the eyes a row at a time rather than a column at a time. The output is identical, but each
+// row reaches the display as a single contiguous write, which suits row-major framebuffers.
+//#define RENDER_ROWS
+
+// Stream each eye to its display in horizontal strips, so the displays need no frame buffers (set USE_FB to
+// false for them in config.h). Each strip is rendered into a small buffer then sent as a single rectangle.
+// This is a synchronous mode for saving RAM, not for speed: writeRect() blocks until a strip has been sent,
+// so the CPU never renders while the SPI bus is busy, as it can with async frame buffer updates. It hasn't
+// been measured on hardware; building the native_timing environment with it defined predicts its frame
+// rate as the "direct" setup. This renders rows, so implies RENDER_ROWS.
+//#define STREAM_STRIPS
+
+#ifdef STREAM_STRIPS
+#ifndef RENDER_ROWS
+#define RENDER_ROWS
+#endif
+/// The number of rows in each strip. Taller strips need fewer writes to the display, but more stack.
+constexpr uint16_t stripHeight = 16;
+#endif
+
+// Build the renderEye() kernels that skip the polar map bounds checks for eyes with guard-banded polar maps.
+// They double the code size of the renderer, so are only built when needed. tablegen.py defines this in the
+// header of any eye it generates with a guard band, so it's enough to include that eye before this file.
+// Without it, guard-banded eyes are drawn with the bounds checks, which gives the same result more slowly.
+//#define GUARDED_POLAR_MAPS
+
+// Render the eyes two pixels at a time, using the DSP instructions of the Cortex-M7 to work on both at once.
+// Other processors get a portable version of the same code that gives identical output.
+//#define RENDER_PAIRS
 
 /// Manages the overall behaviour (movement, blinking, pupil size) of one or more eyes.
-template<std::size_t numEyes, typename Disp>
+/// \tparam numEyes the number of eyes.
+/// \tparam Disp the Display implementation the eyes are drawn on.
+/// \tparam Timing where the time and random numbers come from. See Timing.h.
+template<std::size_t numEyes, typename Disp, typename Timing = ArduinoTiming>
 class EyeController {
 private:
   std::array<Eye<Disp>, numEyes> eyes{};
 
+  Timing timing{};
+
+  /// The time in milliseconds, read once at the start of each frame (or call from outside)
+  uint32_t nowMs{};
+
+  FrameProfiler<> profiler{};
+
   uint32_t eyeIndex{};
 
+  /// How many frames each eye has been passed over for since it was last rendered
+  std::array<uint32_t, numEyes> waiting{};
+
+  /// Once an eye has been passed over this many times, no other eye is rendered until it has been
+  static constexpr uint32_t maxWaiting{4};
+
+  /// The parts of the screen that changed in the last frame rendered
+  ChangedRows changedRows{};
+
   /// Holds the current overall state of the eye(s)
   OverallState state{};
 
@@ -47,7 +103,7 @@ private:
       return;
     }
 
-    uint32_t t = millis();
+    const uint32_t t = nowMs;
 
     // milliseconds elapsed since last eye event
     uint32_t dt = t - state.moveStartTimeMs;
@@ -60,10 +116,10 @@ private:
         // The "move" duration temporarily becomes a hold duration...
         // Normally this is 35 ms to 1 sec, but don't exceed gazeMax setting
         uint32_t limit = std::min(static_cast<uint32_t>(1000), maxGazeMs);
-        state.moveDurationMs = random(35u, limit);         // Time between micro-saccades
+        state.moveDurationMs = timing.random(35u, limit);  // Time between micro-saccades
         if (!state.saccadeIntervalMs) {                    // Cleared when "big" saccade finishes
           state.lastSaccadeStopMs = t;                     // Time when saccade stopped
-          state.saccadeIntervalMs = random(state.moveDurationMs, maxGazeMs); // Next in 30ms to 3sec
+          state.saccadeIntervalMs = timing.random(state.moveDurationMs, maxGazeMs); // Next in 30ms to 3sec
         }
         // Similarly, the "move" start time becomes the "stop" starting time...
         state.moveStartTimeMs = t;               // Save time of event
@@ -85,11 +141,11 @@ private:
         if ((t - state.lastSaccadeStopMs) > state.saccadeIntervalMs) {
           // It's time for a 'big' saccade. r is the radius in X and Y that the eye can go, from (0,0) in the center.
           float r = (static_cast<float>(eye.definition->polar.mapRadius * 2) - static_cast<float>(screenWidth) * M_PI_2) * 0.75f;
-          state.eyeNewX = random(-r, r);
+          state.eyeNewX = timing.random(-r, r);
           const float moveDist = sqrtf(r * r - state.eyeNewX * state.eyeNewX);
-          state.eyeNewY = random(-moveDist, moveDist);
+          state.eyeNewY = timing.random(-moveDist, moveDist);
           // Set the duration for this move, and start it going.
-          state.moveDurationMs = random(83, 166); // ~1/12 - ~1/6 sec
+          state.moveDurationMs = timing.random(83, 166); // ~1/12 - ~1/6 sec
           state.saccadeIntervalMs = 0; // Calc next interval when this one stops
         } else {
           // Microsaccade
@@ -98,11 +154,11 @@ private:
           // that's okay, it'll get put in-bounds on next full saccade.
           float r = static_cast<float>(eye.definition->polar.mapRadius * 2) - static_cast<float>(screenWidth) * M_PI_2;
           r *= 0.07f;
-          const float dx = random(-r, r);
+          const float dx = timing.random(-r, r);
           state.eyeNewX = eye.x - eye.definition->polar.mapRadius + dx;
           const float h = sqrtf(r * r - dx * dx);
-          state.eyeNewY = eye.y - eye.definition->polar.mapRadius + random(-h, h);
-          state.moveDurationMs = random(7, 25); // 7-25 ms microsaccade
+          state.eyeNewY = eye.y - eye.definition->polar.mapRadius + timing.random(-h, h);
+          state.moveDurationMs = timing.random(7, 25); // 7-25 ms microsaccade
         }
         state.eyeNewX += eye.definition->polar.mapRadius;    // Translate new point into map space
         state.eyeNewY += eye.definition->polar.mapRadius;
@@ -120,7 +176,7 @@ private:
     }
 
     if (state.resizing) {
-      uint32_t t = millis();
+      const uint32_t t = nowMs;
 
       // milliseconds elapsed since resize was called
       uint32_t dt = t - state.resizeStartTimeMs;
@@ -146,7 +202,7 @@ private:
       } else {
         n = irisNext[i];
         irisPrev[i] = irisNext[i];
-        irisNext[i] = -0.5f + (static_cast<float>(random(1000)) / 999.0f); // -0.5 to +0.5
+        irisNext[i] = -0.5f + (static_cast<float>(timing.random(1000)) / 999.0f); // -0.5 to +0.5
       }
       iexp = 1 << (irisLevels - i); // ...8,4,2,1
       sum += n / static_cast<float>(iexp);
@@ -161,13 +217,13 @@ private:
   void wink(Eye<Disp> &eye, uint32_t duration) {
     if (eye.blink.state == BlinkState::NotBlinking) {
       eye.blink.state = BlinkState::BlinkClosing;
-      eye.blink.startTimeMs = millis();
+      eye.blink.startTimeMs = nowMs;
       eye.blink.durationMs = duration;
     }
   }
 
   uint32_t doBlink() {
-    const uint32_t blinkDuration = random(50, 100); // Blink for a somewhat random number of milliseconds
+    const uint32_t blinkDuration = timing.random(50, 100); // Blink for a somewhat random number of milliseconds
     // Set up durations for all eyes (if not already winking)
     for (auto &e: eyes) {
       wink(e, blinkDuration);
@@ -179,21 +235,126 @@ private:
     eye.definition = &def;
     eye.currentIrisAngle = def.iris.startAngle;
     eye.currentScleraAngle = def.sclera.startAngle;
+    eye.kernel = kernelIndex(def.sclera.textureMode(), def.iris.textureMode());
+    if (def.sclera.hasTexture()) {
+      eye.scleraLookup.setColumns(def.sclera.texture);
+      // Sclera distances are 0-127, scaled onto the full height of the texture
+      eye.scleraLookup.setRows(def.sclera.texture, 32768 * def.sclera.texture.height / 128);
+    }
+    if (def.iris.hasTexture()) {
+      eye.irisLookup.setColumns(def.iris.texture);
+    }
+    // The iris rows depend on the pupil size, so are calculated when rendering
+    eye.irisRowFactor = -1;
+    updateTiles(eye);
     // Draw the entire eye (including eyelids) on the first frame, to clean up from the previous eye
     eye.drawAll = true;
   }
 
+  /// Works out which area of the polar maps each tile covers relative to the gaze position, and how
+  /// much of it is outside the eyeball. This only depends on the eye definition.
+  void updateTiles(Eye<Disp> &eye) {
+    const int32_t displacementMapSize = screenWidth / 2;
+    const uint8_t *displacement = eye.definition->displacement;
+    for (uint32_t tileX = 0; tileX < tileColumns; tileX++) {
+      for (uint32_t tileY = 0; tileY < tileRows; tileY++) {
+        TileBounds &bounds = eye.tiles.bounds[tileX * tileRows + tileY];
+        bounds = {INT16_MAX, INT16_MIN, INT16_MAX, INT16_MIN, 0};
+        for (int32_t screenX = tileX * tileSize; screenX < static_cast<int32_t>((tileX + 1) * tileSize); screenX++) {
+          // The same displacement map mirroring that renderEye() uses
+          const bool left = screenX < displacementMapSize;
+          const int32_t dcol = left ? displacementMapSize - 1 - screenX : screenX - displacementMapSize;
+          for (int32_t screenY = tileY * tileSize; screenY < static_cast<int32_t>((tileY + 1) * tileSize); screenY++) {
+            const bool top = screenY < displacementMapSize;
+            const int32_t drow = top ? displacementMapSize - 1 - screenY : screenY - displacementMapSize;
+            const int32_t dx = displacement[drow * displacementMapSize + dcol];
+            if (dx == 255) {
+              bounds.outside++;
+              continue;
+            }
+            const int32_t dy = displacement[dcol * displacementMapSize + drow];
+            const int32_t mx = screenX + (left ? -dx : dx);
+            const int32_t my = screenY + (top ? -dy : dy);
+            bounds.minX = std::min<int32_t>(bounds.minX, mx);
+            bounds.maxX = std::max<int32_t>(bounds.maxX, mx);
+            bounds.minY = std::min<int32_t>(bounds.minY, my);
+            bounds.maxY = std::max<int32_t>(bounds.maxY, my);
+          }
+        }
+      }
+    }
+    // The same conversion from screen to polar map pixels that tablegen.py uses
+    const float eyeRadius = eye.definition->radius;
+    const float irisRadius = eye.definition->iris.radius;
+    eye.tiles.irisRadius = atan2f(irisRadius, sqrtf(eyeRadius * eyeRadius - irisRadius * irisRadius))
+                           / static_cast<float>(M_PI_2) * static_cast<float>(eye.definition->polar.mapRadius);
+  }
+
+  /// Classifies each tile for the current frame, based on where it falls on the polar maps. This is
+  /// conservative: a tile is only given a solid class if every one of its pixels definitely has that
+  /// color, so anything close to a boundary is Mixed.
+  /// \param withPupil whether tiles can be classified as Pupil.
+  void classifyTiles(const Eye<Disp> &eye, int32_t xPositionOverMap, int32_t yPositionOverMap, int32_t irisSize,
+                     bool solidSclera, bool withPupil, std::array<TileClass, tileColumns * tileRows> &tiles) const {
+    const int32_t mapRadius = eye.definition->polar.mapRadius;
+    const int32_t mapDiameter = mapRadius * 2;
+    // Distances are doubled, so the map center at (mapRadius - 0.5) is an integer
+    const int32_t center = mapDiameter - 1;
+    const int32_t eyeLimit = mapDiameter * mapDiameter;
+    // Allow a pixel of slack around the iris and pupil edges, since they come from floating point maths
+    const float irisRadius = eye.tiles.irisRadius;
+    const int32_t irisLimit = static_cast<int32_t>((irisRadius + 1.0f) * (irisRadius + 1.0f) * 4.0f);
+    const float pupilRadius = irisRadius * (1.0f - static_cast<float>(irisSize - 128) / 127.0f) - 1.0f;
+    const int32_t pupilLimit = pupilRadius > 0.0f && withPupil ? static_cast<int32_t>(pupilRadius * pupilRadius * 4.0f) : 0;
+
+    for (uint32_t i = 0; i < tiles.size(); i++) {
+      const TileBounds &bounds = eye.tiles.bounds[i];
+      if (bounds.outside) {
+        tiles[i] = bounds.outside == tileSize * tileSize ? TileClass::Eyelid : TileClass::Mixed;
+        continue;
+      }
+      const int32_t x0 = xPositionOverMap + bounds.minX;
+      const int32_t x1 = xPositionOverMap + bounds.maxX;
+      const int32_t y0 = yPositionOverMap + bounds.minY;
+      const int32_t y1 = yPositionOverMap + bounds.maxY;
+      const int32_t u0 = x0 * 2 - center, u1 = x1 * 2 - center;
+      const int32_t v0 = y0 * 2 - center, v1 = y1 * 2 - center;
+      const int32_t nearU = u0 > 0 ? u0 : u1 < 0 ? -u1 : 0;
+      const int32_t nearV = v0 > 0 ? v0 : v1 < 0 ? -v1 : 0;
+      const int32_t near = nearU * nearU + nearV * nearV;
+      if (near > eyeLimit) {
+        // Every point is beyond the edge of the eye
+        tiles[i] = TileClass::Back;
+        continue;
+      }
+      if (x0 < 0 || x1 >= mapDiameter || y0 < 0 || y1 >= mapDiameter) {
+        tiles[i] = TileClass::Mixed;
+        continue;
+      }
+      const int32_t farU = std::max(std::abs(u0), std::abs(u1));
+      const int32_t farV = std::max(std::abs(v0), std::abs(v1));
+      const int32_t far = farU * farU + farV * farV;
+      if (solidSclera && far <= eyeLimit && near > irisLimit) {
+        tiles[i] = TileClass::Sclera;
+      } else if (far < pupilLimit) {
+        tiles[i] = TileClass::Pupil;
+      } else {
+        tiles[i] = TileClass::Mixed;
+      }
+    }
+  }
+
   /// If autoBlink is enabled, periodically starts the eyes blinking.
   void applyAutoBlink() {
     if (!autoBlink) {
       return;
     }
 
-    const uint32_t t = millis();
+    const uint32_t t = nowMs;
     if (t - state.timeOfLastBlinkMs >= state.timeToNextBlinkMs) {
       state.timeOfLastBlinkMs = t;
       const uint32_t blinkDuration = doBlink();
-      state.timeToNextBlinkMs = blinkDuration * 3 + random(4000);
+      state.timeToNextBlinkMs = blinkDuration * 3 + timing.random(4000);
     }
   }
 
@@ -203,7 +364,7 @@ private:
   /// and 1 means the eye is fully closed.
   float updateBlinkState(Eye<Disp> &eye) {
     auto &blink = eye.blink;
-    const uint32_t t = millis();
+    const uint32_t t = nowMs;
     float blinkFactor{};
     if (blink.state != BlinkState::NotBlinking) {
       // The eye is currently blinking. We scale the upper/lower thresholds relative
@@ -298,7 +459,7 @@ private:
   /// and the current point in time.
   /// \param eye the eye to apply the spin to.
   void applySpin(Eye<Disp> &eye) {
-    const float minutes = static_cast<float>(millis()) / 60000.0f;
+    const float minutes = static_cast<float>(nowMs) / 60000.0f;
     if (eye.definition->iris.iSpin) {
       // Spin works in fixed amount per frame (eyes may lose sync, but "wagon wheel" tricks work)
       eye.currentIrisAngle += eye.definition->iris.iSpin;
@@ -316,16 +477,82 @@ private:
     }
   }
 
-  /// Draws an entire eye to the screen.
+  using RenderFunction = bool (EyeController::*)(Eye<Disp> &, float, float, float);
+
+#ifdef GUARDED_POLAR_MAPS
+  static constexpr bool guardedKernels{true};
+#else
+  static constexpr bool guardedKernels{false};
+#endif
+
+  static constexpr uint8_t kernelIndex(TextureMode scleraMode, TextureMode irisMode) {
+    return static_cast<uint8_t>(scleraMode) * 3 + static_cast<uint8_t>(irisMode);
+  }
+
+  /// Looks up the renderEye() kernel that was specialised for a particular combination of sclera
+  /// and iris features. The index is chosen once per EyeDefinition, see updateDefinition().
+  /// \param index the kernel index for the eye definition.
+  /// \param guarded true to skip the polar map bounds checks, see withinGuard().
+  static RenderFunction kernel(uint8_t index, bool guarded) {
+    // Without GUARDED_POLAR_MAPS the second row is the same kernels as the first, so nothing extra is built
+    static constexpr RenderFunction kernels[2][9] = {
+        {
+            &EyeController::renderEye<TextureMode::Color, TextureMode::Color, false>,
+            &EyeController::renderEye<TextureMode::Color, TextureMode::Texture, false>,
+            &EyeController::renderEye<TextureMode::Color, TextureMode::Rotated, false>,
+            &EyeController::renderEye<TextureMode::Texture, TextureMode::Color, false>,
+            &EyeController::renderEye<TextureMode::Texture, TextureMode::Texture, false>,
+            &EyeController::renderEye<TextureMode::Texture, TextureMode::Rotated, false>,
+            &EyeController::renderEye<TextureMode::Rotated, TextureMode::Color, false>,
+            &EyeController::renderEye<TextureMode::Rotated, TextureMode::Texture, false>,
+            &EyeController::renderEye<TextureMode::Rotated, TextureMode::Rotated, false>,
+        },
+        {
+            &EyeController::renderEye<TextureMode::Color, TextureMode::Color, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Color, TextureMode::Texture, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Color, TextureMode::Rotated, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Texture, TextureMode::Color, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Texture, TextureMode::Texture, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Texture, TextureMode::Rotated, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Rotated, TextureMode::Color, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Rotated, TextureMode::Texture, guardedKernels>,
+            &EyeController::renderEye<TextureMode::Rotated, TextureMode::Rotated, guardedKernels>,
+        },
+    };
+    return kernels[guarded][index];
+  }
+
+  /// Determines whether every point of the eye that might be drawn falls inside the eye's
+  /// guard-banded polar maps. No point on the eye is further than mapRadius from the gaze position,
+  /// so this holds for as long as the gaze stays less than the guard band's width from the center.
+  /// \param eye the eye to check.
+  /// \return true if the polar map lookups can skip their bounds checks. Always false without GUARDED_POLAR_MAPS.
+  static bool withinGuard(const Eye<Disp> &eye) {
+    if (!guardedKernels) {
+      return false;
+    }
+    const PolarParams &polar = eye.definition->polar;
+    const int32_t x = static_cast<int32_t>(eye.x - screenWidth / 2) + screenWidth / 2 - polar.mapRadius;
+    const int32_t y = static_cast<int32_t>(eye.y - screenHeight / 2) + screenHeight / 2 - polar.mapRadius;
+    return std::abs(x) < polar.guard && std::abs(y) < polar.guard;
+  }
+
+  /// Draws the parts of an eye that have changed since it was last drawn.
+  /// \tparam scleraMode how the sclera is shaded. This must match the eye definition's sclera.
+  /// \tparam irisMode how the iris is shaded. This must match the eye definition's iris.
+  /// \tparam guarded true if the polar maps have a guard band wide enough for the current gaze position.
   /// \param eye the eye to draw.
   /// \param upperFactor How open the upper eyelid is. 0 = fully closed, 1 = fully open.
   /// \param lowerFactor How open the lower eyelid is. 0 = fully closed, 1 = fully open.
   /// \param blinkFactor How much the eye is blinking. 0 = not blinking, 1 = fully blinking (closed).
-  void renderEye(Eye<Disp> &eye, float upperFactor, float lowerFactor, float blinkFactor) {
+  /// \return true if anything was drawn, false if the eye looks exactly the same as last time.
+  template<TextureMode scleraMode, TextureMode irisMode, bool guarded>
+  bool renderEye(Eye<Disp> &eye, float upperFactor, float lowerFactor, float blinkFactor) {
 
     const int32_t displacementMapSize = screenWidth / 2;
     const int32_t mapRadius = eye.definition->polar.mapRadius;
     const int32_t mapDiameter = mapRadius * 2;
+    const int32_t mapStride = mapRadius + eye.definition->polar.guard;
 
     Disp &display = *eye.display;
     EyeBlink &blink = eye.blink;
@@ -335,8 +562,7 @@ private:
 
     const ScleraParams &sclera = eye.definition->sclera;
     const IrisParams &iris = eye.definition->iris;
-    bool hasScleraTexture = sclera.hasTexture();
-    bool hasIrisTexture = iris.hasTexture();
+    constexpr bool hasIrisTexture = irisMode != TextureMode::Color;
 
     const float pupilRange = eye.definition->pupil.max - eye.definition->pupil.min;
     const float irisValue = 1.0f - (eye.definition->pupil.min + pupilRange * state.pupilAmount);
@@ -344,6 +570,13 @@ private:
     // We scale this up by 32768 to give us more precision but still use integer maths in the inner loop.
     // The 126 is the maximum distance value we can expect from the polar distance map.
     int32_t iPupilFactor = static_cast<int32_t>(32768.0f / 126.0f * (irisTextureHeight - 1) / irisValue);
+    if constexpr (hasIrisTexture) {
+      // Only recalculate the iris texture rows when the pupil size has changed
+      if (iPupilFactor != eye.irisRowFactor) {
+        eye.irisLookup.setRows(iris.texture, iPupilFactor);
+        eye.irisRowFactor = iPupilFactor;
+      }
+    }
     // We scale up by 126 and add 128 to match the 128-254 range of the distance map. It means a bit
     // less math in the inner loop.
     const int32_t irisSize = static_cast<int32_t>(126.0f * irisValue) + 128;
@@ -363,168 +596,704 @@ private:
     eye.lowerLidFactor = lowerFactor;
     blink.blinkFactor = blinkFactor;
 
+    // Work out what has changed since the last frame. If the gaze hasn't moved then every pixel
+    // maps to the same place in the polar maps as last time, so any column where the eyelids
+    // haven't moved either only needs redrawing if the shading of the sclera or iris/pupil changed.
+    DamageState &damage = eye.damage;
+    const bool gazeChanged = eye.drawAll || xPositionOverMap != damage.x || yPositionOverMap != damage.y;
+    const bool lidsChanged = upperF != prevUpperF || lowerF != prevLowerF;
+    const bool scleraChanged = scleraMode == TextureMode::Rotated && eye.currentScleraAngle != damage.scleraAngle;
+    const bool irisChanged = irisSize != damage.irisSize || iPupilFactor != damage.pupilFactor
+                             || (irisMode == TextureMode::Rotated && eye.currentIrisAngle != damage.irisAngle);
+    if (!gazeChanged && !lidsChanged && !scleraChanged && !irisChanged) {
+      return false;
+    }
+    // Columns where the gaze, eyelids and sclera are all unchanged only need their iris area redrawing,
+    // using the extents of the iris that were found last time.
+    const bool stillEye = !gazeChanged && !scleraChanged;
+    bool drawn{};
+    changedRows.clear();
+
+    damage.x = xPositionOverMap;
+    damage.y = yPositionOverMap;
+    damage.irisSize = irisSize;
+    damage.pupilFactor = iPupilFactor;
+    damage.irisAngle = eye.currentIrisAngle;
+    damage.scleraAngle = eye.currentScleraAngle;
+
     // Hoist these out of the inner loops
     const uint8_t *angleLookup = eye.definition->polar.angle;
     const uint8_t *distanceLookup = eye.definition->polar.distance;
+    const uint16_t *polarMap = eye.definition->polar.map;
     const uint16_t pupilColor = eye.definition->pupil.color;
     const uint16_t backColor = eye.definition->backColor;
     const EyelidParams &eyelids = eye.definition->eyelids;
     const uint16_t eyelidColor = eyelids.color;
     const uint8_t *displacement = eye.definition->displacement;
 
+    // Shades a pixel of the eyeball, given where it lies on the polar angle/distance maps.
+    // onIris is called for pixels that are part of the iris or pupil.
+    const auto shade = [&](auto &&onIris, uint32_t angle, int32_t distance) -> uint16_t {
+      if (distance < 128) {
+        // We're in the sclera
+        if constexpr (scleraMode != TextureMode::Color) {
+          if constexpr (scleraMode == TextureMode::Rotated) {
+            angle = ((angle + eye.currentScleraAngle) & 1023) ^ sclera.mirror;
+          }
+          return eye.scleraLookup.get(sclera.texture, angle & 1023, distance);
+        } else {
+          return sclera.color;
+        }
+      }
+      if (distance < 255) {
+        // Either the iris or pupil
+        onIris();
+        if (distance >= irisSize) {
+          // Pupil
+          return pupilColor;
+        }
+        // Iris
+        if constexpr (hasIrisTexture) {
+          if constexpr (irisMode == TextureMode::Rotated) {
+            angle = ((angle + eye.currentIrisAngle) & 1023) ^ iris.mirror;
+          }
+          return eye.irisLookup.get(iris.texture, angle & 1023, distance - 128);
+        } else {
+          return iris.color;
+        }
+      }
+      // Back of eye
+      return backColor;
+    };
+
+    // Looks up where a point lies on the polar angle/distance maps. The point must be inside the maps.
+    const auto lookup = [&](int32_t mx, int32_t my, uint32_t &angle, int32_t &distance) {
+      if (polarMap) {
+        // The interleaved map is stored by column, and the angle held for each point is the one in
+        // quadrant 1. Quadrants 2 and 4 want the angle of the transposed point instead, which is the
+        // mirror image of the stored one apart from the diagonal, where both are the same.
+        uint32_t entry;
+        if (my >= mapRadius) {
+          my -= mapRadius;
+          if (mx >= mapRadius) {
+            // Quadrant 1 (bottom right)
+            mx -= mapRadius;
+            entry = polarMap[mx * mapStride + my];
+            angle = entry & 0xFF;
+          } else {
+            // Quadrant 2 (bottom left)
+            mx = mapRadius - mx - 1;
+            entry = polarMap[mx * mapStride + my];
+            angle = 1023 - (entry & 0xFF) + (mx == my);
+          }
+        } else {
+          my = mapRadius - my - 1;
+          if (mx < mapRadius) {
+            // Quadrant 3 (top left)
+            mx = mapRadius - mx - 1;
+            entry = polarMap[mx * mapStride + my];
+            angle = (entry & 0xFF) + 512;
+          } else {
+            // Quadrant 4 (top right)
+            mx -= mapRadius;
+            entry = polarMap[mx * mapStride + my];
+            angle = 511 - (entry & 0xFF) + (mx == my);
+          }
+        }
+        distance = entry >> 8;
+        return;
+      }
+      // We're inside the polar angle/distance maps
+      int32_t moff;
+      if (my >= mapRadius) {
+        my -= mapRadius;
+        if (mx >= mapRadius) {
+          // Quadrant 1 (bottom right), so we can use the angle/dist lookups directly
+          mx -= mapRadius;
+          moff = my * mapStride + mx;
+          angle = angleLookup[moff];
+          distance = distanceLookup[moff];
+        } else {
+          // Quadrant 2 (bottom left), so rotate angle by 270 degrees clockwise (768) and mirror distance on X axis
+          mx = mapRadius - mx - 1;
+          angle = angleLookup[mx * mapStride + my] + 768;
+          distance = distanceLookup[my * mapStride + mx];
+        }
+      } else {
+        if (mx < mapRadius) {
+          // Quadrant 3 (top left), so rotate angle by 180 degrees and mirror distance on the X and Y axes
+          mx = mapRadius - mx - 1;
+          my = mapRadius - my - 1;
+          moff = my * mapStride + mx;
+          angle = angleLookup[moff] + 512;
+          distance = distanceLookup[moff];
+        } else {
+          // Quadrant 4 (top right), so rotate angle by 90 degrees clockwise (256) and mirror distance on Y axis
+          mx -= mapRadius;
+          my = mapRadius - my - 1;
+          angle = angleLookup[mx * mapStride + my] + 256;
+          distance = distanceLookup[my * mapStride + mx];
+        }
+      }
+    };
+
+    // Finds where a point lies on the polar angle/distance maps. Anything outside the maps is the back of the eye.
+    // Guard-banded maps are big enough that every point the gaze can reach is inside them, so need no checks.
+    const auto polar = [&](int32_t mx, int32_t my, uint32_t &angle, int32_t &distance) {
+      angle = 0;
+      distance = 255;
+      if (guarded || (mx >= 0 && mx < mapDiameter && my >= 0 && my < mapDiameter)) {
+        lookup(mx, my, angle, distance);
+      }
+    };
+
+#ifdef RENDER_ROWS
+    // Work out which rows of each column need drawing, just as the column renderer would, then transpose
+    // that into the span of columns that needs drawing on each row. Every row is then rendered and sent
+    // to the display in a single call. Any pixel inside a span that didn't strictly need redrawing is
+    // drawn exactly as it already appears on screen.
+    std::array<uint8_t, screenWidth> upperLids, lowerLids;
+    std::array<bool, screenWidth> recordIris{};
+    std::array<uint8_t, screenHeight> spanStart{}, spanEnd{};
     for (uint32_t screenX = 0; screenX < screenWidth; screenX++) {
-      // Determine the extents of the eye that need to be drawn, based on where the eyelids
-      // are located in both this and the previous frame
-      auto currentUpper = eyelids.upperLid(screenX, upperF);
-      auto currentLower = eyelids.lowerLid(screenX, lowerF);
+      const uint8_t currentUpper = eyelids.upperLid(screenX, upperF);
+      const uint8_t currentLower = eyelids.lowerLid(screenX, lowerF);
+      upperLids[screenX] = currentUpper;
+      lowerLids[screenX] = currentLower;
 
       uint32_t minY, maxY;
-      if (eye.drawAll) {
-        minY = 0;
-        maxY = screenHeight;
+      bool irisOnly = stillEye && !lidsChanged;
+      if (!irisOnly) {
+        if (eye.drawAll) {
+          minY = 0;
+          maxY = screenHeight;
+        } else {
+          const uint8_t previousUpper = eyelids.upperLid(screenX, prevUpperF);
+          const uint8_t previousLower = eyelids.lowerLid(screenX, prevLowerF);
+          irisOnly = stillEye && currentUpper == previousUpper && currentLower == previousLower;
+          minY = std::min(currentUpper, previousUpper);
+          maxY = std::max(currentLower, previousLower);
+        }
+      }
+      if (irisOnly) {
+        if (!irisChanged) {
+          continue;
+        }
+        minY = damage.irisStart[screenX];
+        maxY = damage.irisEnd[screenX];
       } else {
-        auto previousUpper = eyelids.upperLid(screenX, prevUpperF);
-        minY = std::min(currentUpper, previousUpper);
-        auto previousLower = eyelids.lowerLid(screenX, prevLowerF);
-        maxY = std::max(currentLower, previousLower);
+        // The iris extents of this column are found again as its rows are drawn
+        recordIris[screenX] = true;
+        damage.irisStart[screenX] = 0;
+        damage.irisEnd[screenX] = 0;
+      }
+      for (uint32_t screenY = minY; screenY < maxY; screenY++) {
+        if (!spanEnd[screenY]) {
+          spanStart[screenY] = screenX;
+        }
+        spanEnd[screenY] = screenX + 1;
+      }
+    }
+
+#ifdef STREAM_STRIPS
+    // Where it's worth it, widen the spans so the rows that need drawing in a strip form a single rectangle.
+    // As above, the extra pixels are drawn just as they already appear.
+    std::array<bool, (screenHeight + stripHeight - 1) / stripHeight> wholeStrip{};
+    for (uint32_t top = 0; top < screenHeight; top += stripHeight) {
+      const uint32_t bottom = std::min<uint32_t>(top + stripHeight, screenHeight);
+      uint32_t first = bottom, last = top, area = 0;
+      uint8_t start = UINT8_MAX, end = 0;
+      for (uint32_t screenY = top; screenY < bottom; screenY++) {
+        if (spanEnd[screenY]) {
+          first = std::min(first, screenY);
+          last = screenY + 1;
+          start = std::min(start, spanStart[screenY]);
+          end = std::max(end, spanEnd[screenY]);
+          area += spanEnd[screenY] - spanStart[screenY];
+        }
+      }
+      if (first >= last || (end - start) * (last - first) - area > (last - first - 1) * writeCost) {
+        continue;
+      }
+      wholeStrip[top / stripHeight] = true;
+      for (uint32_t screenY = first; screenY < last; screenY++) {
+        spanStart[screenY] = start;
+        spanEnd[screenY] = end;
+      }
+    }
+#endif
+    std::copy(spanStart.begin(), spanStart.end(), changedRows.start.begin());
+    std::copy(spanEnd.begin(), spanEnd.end(), changedRows.end.begin());
+
+    // Cached geometry is laid out by column, so it isn't used when rendering rows
+    GeometryCache *cache = nullptr;
+#else
+    // Nothing in the geometry cache is any use once the gaze has moved
+    GeometryCache *cache = eye.geometryCache;
+    if (cache && gazeChanged) {
+      cache->start.fill(0);
+      cache->end.fill(0);
+    }
+#endif
+
+    // Find the tiles that are a single solid color. Pupil tiles are only filled when there's no cache,
+    // since the cache needs the real distances to be able to follow later changes in pupil size.
+    std::array<TileClass, tileColumns * tileRows> tiles;
+    classifyTiles(eye, xPositionOverMap, yPositionOverMap, irisSize, scleraMode == TextureMode::Color,
+                  !cache && eye.definition->pupil.slitRadius == 0, tiles);
+
+#ifdef RENDER_ROWS
+#ifdef STREAM_STRIPS
+    uint16_t strip[stripHeight * screenWidth];
+    uint32_t stripRows = 0;
+#else
+    uint16_t row[screenWidth];
+#endif
+
+    for (uint32_t screenY = 0; screenY < screenHeight; screenY++) {
+      const uint32_t minX = spanStart[screenY];
+      const uint32_t maxX = spanEnd[screenY];
+      if (minX >= maxX) {
+        continue;
       }
 
       // Figure out where we are in the displacement map. The eye (sphere) is symmetrical over
-      // X and Y, so we can just swap axes to look up the Y displacement using the same table.
-      const uint8_t *displaceX, *displaceY;
-      int32_t xmul; // Sign of X displacement: +1 or -1
-      int32_t doff; // Offset into displacement arrays
-      if (screenX < (screenWidth / 2)) {
-        // Left half of screen, so we need to horizontally flip our displacement map lookup
-        displaceX = &displacement[displacementMapSize - 1 - screenX];
-        displaceY = &displacement[(displacementMapSize - 1 - screenX) * displacementMapSize];
-        xmul = -1; // X displacement is always negative
+      // X and Y, so the Y displacement comes from the same table with the axes swapped.
+      int32_t ymul; // Sign of Y displacement: +1 or -1
+      int32_t doff; // Row of the displacement map
+      if (screenY < displacementMapSize) {
+        // Top half of the screen, so we need to vertically flip the displacement map lookup
+        doff = displacementMapSize - screenY - 1;
+        ymul = -1;
       } else {
-        // Right half of screen, so we can lookup horizontally as-is
-        displaceX = &displacement[screenX - displacementMapSize];
-        displaceY = &displacement[(screenX - displacementMapSize) * displacementMapSize];
-        xmul = 1; // X displacement is always positive
+        // Bottom half of the screen
+        doff = screenY - displacementMapSize;
+        ymul = 1;
       }
+      const uint8_t *displaceX = &displacement[doff * displacementMapSize];
+      const uint8_t *displaceY = &displacement[doff];
+
+      const int32_t yy = yPositionOverMap + screenY;
+      const TileClass *tileRow = &tiles[screenY / tileSize];
+#ifdef STREAM_STRIPS
+      const bool whole = wholeStrip[screenY / stripHeight];
+      uint16_t *row = whole ? &strip[stripRows++ * (maxX - minX)] : strip;
+#endif
+      uint16_t *pixel = row;
+      uint32_t screenX = minX;
+      while (screenX < maxX) {
+        // Work through the row one tile at a time
+        const uint32_t tileEnd = std::min<uint32_t>(maxX, (screenX / tileSize + 1) * tileSize);
+        const TileClass tile = tileRow[(screenX / tileSize) * tileRows];
+        if (tile != TileClass::Mixed) {
+          uint16_t p;
+          switch (tile) {
+            case TileClass::Eyelid:
+              p = eyelidColor;
+              break;
+            case TileClass::Back:
+              p = backColor;
+              break;
+            case TileClass::Sclera:
+              p = sclera.color;
+              break;
+            default:
+              p = pupilColor;
+              break;
+          }
+          for (; screenX < tileEnd; screenX++) {
+            if (screenY < upperLids[screenX] || screenY >= lowerLids[screenX]) {
+              *pixel++ = eyelidColor;
+            } else {
+              if (tile == TileClass::Pupil && recordIris[screenX]) {
+                if (!damage.irisEnd[screenX]) {
+                  damage.irisStart[screenX] = screenY;
+                }
+                damage.irisEnd[screenX] = screenY + 1;
+              }
+              *pixel++ = p;
+            }
+          }
+          continue;
+        }
 
-      // draw any part of the upper eyelid that needs repainting
-      if (currentUpper > minY) {
-        display.drawFastVLine(screenX, minY, currentUpper - minY, eyelidColor);
-        minY = currentUpper;
+        for (; screenX < tileEnd; screenX++) {
+          if (screenY < upperLids[screenX] || screenY >= lowerLids[screenX]) {
+            // Covered by one of the eyelids
+            *pixel++ = eyelidColor;
+            continue;
+          }
+          int32_t dcol, xmul;
+          if (screenX < displacementMapSize) {
+            // Left half of screen, so we need to horizontally flip our displacement map lookup
+            dcol = displacementMapSize - 1 - screenX;
+            xmul = -1;
+          } else {
+            dcol = screenX - displacementMapSize;
+            xmul = 1;
+          }
+          const int32_t dx = displaceX[dcol];
+          if (dx < 255) {
+            // We're inside the eyeball (sclera/iris/pupil) area
+            const int32_t dy = displaceY[dcol * displacementMapSize];
+            uint32_t angle;
+            int32_t distance;
+            polar(xPositionOverMap + screenX + dx * xmul, yy + dy * ymul, angle, distance);
+            *pixel++ = shade([&] {
+              if (recordIris[screenX]) {
+                if (!damage.irisEnd[screenX]) {
+                  damage.irisStart[screenX] = screenY;
+                }
+                damage.irisEnd[screenX] = screenY + 1;
+              }
+            }, angle, distance);
+          } else {
+            // We're outside the eye area, i.e. this must be on an eyelid
+            *pixel++ = eyelidColor;
+          }
+        } // end tile
       }
-      // draw any part of the lower eyelid that needs repainting
-      if (currentLower < maxY) {
-        display.drawFastVLine(screenX, currentLower, maxY - currentLower, eyelidColor);
-        maxY = currentLower;
+#ifdef STREAM_STRIPS
+      // Rows of a strip that wasn't worth widening go straight out, otherwise the strip goes once its last row is done
+      if (!whole) {
+        display.writeSpan(minX, screenY, maxX - minX, row);
+      } else if ((screenY + 1) % stripHeight == 0 || screenY + 1 == screenHeight || !spanEnd[screenY + 1]) {
+        display.writeRect(minX, screenY + 1 - stripRows, maxX - minX, stripRows, strip);
+        stripRows = 0;
       }
+#else
+      display.writeSpan(minX, screenY, maxX - minX, row);
+#endif
+      drawn = true;
+    } // end row
+#else
+    // Each column of the eye is rendered here, then sent to the display in a single call
+    uint16_t column[screenHeight];
+
+#ifdef RENDER_PAIRS
+    // Limits and colors for working on pairs of pixels
+    const simd::Pair mapLimit = simd::pack(mapDiameter, mapDiameter);
+    const simd::Pair scleraLimit = simd::pack(128, 128);
+    const simd::Pair irisLimit = simd::pack(irisSize, irisSize);
+    const simd::Pair pupilLimit = simd::pack(255, 255);
+    const simd::Pair solidLimit = simd::pack(256, 256);
+    const simd::Pair scleraPair = simd::pack(sclera.color, sclera.color);
+    const simd::Pair irisPair = simd::pack(iris.color, iris.color);
+    const simd::Pair pupilPair = simd::pack(pupilColor, pupilColor);
+    const simd::Pair backPair = simd::pack(backColor, backColor);
+    const simd::Pair eyelidPair = simd::pack(eyelidColor, eyelidColor);
+#endif
 
-      // draw everything else
-      const int32_t xx = xPositionOverMap + screenX;
-      for (uint32_t screenY = minY; screenY < maxY; screenY++) {
-        uint32_t p;
-
-        const int32_t yy = yPositionOverMap + screenY;
-        int32_t dx, dy;
-        if (screenY < displacementMapSize) {
-          // We're in the top half of the screen, so we need to vertically flip the displacement map lookup
-          doff = displacementMapSize - screenY - 1;
-          dy = -displaceY[doff];
+    for (uint32_t screenX = 0; screenX < screenWidth; screenX++) {
+      uint32_t minY, maxY;
+      bool irisOnly = stillEye && !lidsChanged;
+      if (!irisOnly) {
+        // Determine the extents of the eye that need to be drawn, based on where the eyelids
+        // are located in both this and the previous frame
+        auto currentUpper = eyelids.upperLid(screenX, upperF);
+        auto currentLower = eyelids.lowerLid(screenX, lowerF);
+
+        if (eye.drawAll) {
+          minY = 0;
+          maxY = screenHeight;
         } else {
-          // We're in the bottom half of the screen
-          doff = screenY - displacementMapSize;
-          dy = displaceY[doff];
+          auto previousUpper = eyelids.upperLid(screenX, prevUpperF);
+          auto previousLower = eyelids.lowerLid(screenX, prevLowerF);
+          irisOnly = stillEye && currentUpper == previousUpper && currentLower == previousLower;
+          minY = std::min(currentUpper, previousUpper);
+          maxY = std::max(currentLower, previousLower);
         }
-        dx = displaceX[doff * displacementMapSize];
-        if (dx < 255) {
-          // We're inside the eyeball (sclera/iris/pupil) area
-          dx *= xmul;  // Flip x offset sign if in left half of screen
-          int32_t mx = xx + dx;
-          int32_t my = yy + dy;
-
-          if (mx >= 0 && mx < mapDiameter && my >= 0 && my < mapDiameter) {
-            // We're inside the polar angle/distance maps
-            uint32_t angle;
-            int32_t distance, moff;
-            if (my >= mapRadius) {
-              my -= mapRadius;
-              if (mx >= mapRadius) {
-                // Quadrant 1 (bottom right), so we can use the angle/dist lookups directly
-                mx -= mapRadius;
-                moff = my * mapRadius + mx;
-                angle = angleLookup[moff];
-                distance = distanceLookup[moff];
-              } else {
-                // Quadrant 2 (bottom left), so rotate angle by 270 degrees clockwise (768) and mirror distance on X axis
-                mx = mapRadius - mx - 1;
-                angle = angleLookup[mx * mapRadius + my] + 768;
-                distance = distanceLookup[my * mapRadius + mx];
-              }
-            } else {
-              if (mx < mapRadius) {
-                // Quadrant 3 (top left), so rotate angle by 180 degrees and mirror distance on the X and Y axes
-                mx = mapRadius - mx - 1;
-                my = mapRadius - my - 1;
-                moff = my * mapRadius + mx;
-                angle = angleLookup[moff] + 512;
-                distance = distanceLookup[moff];
-              } else {
-                // Quadrant 4 (top right), so rotate angle by 90 degrees clockwise (256) and mirror distance on Y axis
-                mx -= mapRadius;
-                my = mapRadius - my - 1;
-                angle = angleLookup[mx * mapRadius + my] + 256;
-                distance = distanceLookup[my * mapRadius + mx];
+        if (!irisOnly) {
+          changedRows.addColumn(screenX, minY, maxY);
+        }
+
+        // draw any part of the upper eyelid that needs repainting
+        if (currentUpper > minY) {
+          display.drawFastVLine(screenX, minY, currentUpper - minY, eyelidColor);
+          minY = currentUpper;
+          drawn = true;
+        }
+        // draw any part of the lower eyelid that needs repainting
+        if (currentLower < maxY) {
+          display.drawFastVLine(screenX, currentLower, maxY - currentLower, eyelidColor);
+          maxY = currentLower;
+          drawn = true;
+        }
+      }
+      if (irisOnly) {
+        if (!irisChanged) {
+          continue;
+        }
+        minY = damage.irisStart[screenX];
+        maxY = damage.irisEnd[screenX];
+        changedRows.addColumn(screenX, minY, maxY);
+      }
+
+      // draw everything else, keeping track of where the iris is in case only it changes next time
+      uint16_t *pixel = column;
+      uint32_t irisStart{}, irisEnd{};
+      uint32_t screenY = minY;
+      const auto trackIrisAt = [&](uint32_t y) {
+        if (!irisEnd) {
+          irisStart = y;
+        }
+        irisEnd = y + 1;
+      };
+      const auto trackIris = [&] { trackIrisAt(screenY); };
+
+      // If this column's geometry has already been cached for the current gaze position,
+      // all that's left to do is the shading
+      uint16_t *cachedAngle{};
+      uint8_t *cachedDistance{};
+      bool cached{};
+      if (cache) {
+        cachedAngle = &cache->angle[screenX * screenHeight];
+        cachedDistance = &cache->distance[screenX * screenHeight];
+        cached = minY >= cache->start[screenX] && maxY <= cache->end[screenX];
+        if (!cached && minY < maxY) {
+          // The rows drawn below are about to be cached, so extend the cached range to include them
+          if (minY <= cache->end[screenX] && maxY >= cache->start[screenX]) {
+            cache->start[screenX] = std::min<uint32_t>(minY, cache->start[screenX]);
+            cache->end[screenX] = std::max<uint32_t>(maxY, cache->end[screenX]);
+          } else {
+            cache->start[screenX] = minY;
+            cache->end[screenX] = maxY;
+          }
+        }
+      }
+
+      if (cached) {
+        for (; screenY < maxY; screenY++) {
+          const int32_t distance = cachedDistance[screenY];
+          if (distance < 255) {
+            *pixel++ = shade(trackIris, cachedAngle[screenY], distance);
+          } else {
+            *pixel++ = cachedAngle[screenY] == GeometryCache::eyelid ? eyelidColor : backColor;
+          }
+        }
+      } else {
+        // Figure out where we are in the displacement map. The eye (sphere) is symmetrical over
+        // X and Y, so we can just swap axes to look up the Y displacement using the same table.
+        const uint8_t *displaceX, *displaceY;
+        int32_t xmul; // Sign of X displacement: +1 or -1
+        int32_t doff; // Offset into displacement arrays
+        if (screenX < (screenWidth / 2)) {
+          // Left half of screen, so we need to horizontally flip our displacement map lookup
+          displaceX = &displacement[displacementMapSize - 1 - screenX];
+          displaceY = &displacement[(displacementMapSize - 1 - screenX) * displacementMapSize];
+          xmul = -1; // X displacement is always negative
+        } else {
+          // Right half of screen, so we can lookup horizontally as-is
+          displaceX = &displacement[screenX - displacementMapSize];
+          displaceY = &displacement[(screenX - displacementMapSize) * displacementMapSize];
+          xmul = 1; // X displacement is always positive
+        }
+
+        const int32_t xx = xPositionOverMap + screenX;
+#ifdef RENDER_PAIRS
+        const simd::Pair xxPair = simd::pack(xx, xx);
+#endif
+        const TileClass *tileColumn = &tiles[(screenX / tileSize) * tileRows];
+        while (screenY < maxY) {
+          // Work through the column one tile at a time
+          const uint32_t tileEnd = std::min<uint32_t>(maxY, (screenY / tileSize + 1) * tileSize);
+          const TileClass tile = tileColumn[screenY / tileSize];
+          if (tile != TileClass::Mixed) {
+            uint16_t p;
+            switch (tile) {
+              case TileClass::Eyelid:
+                p = eyelidColor;
+                break;
+              case TileClass::Back:
+                p = backColor;
+                break;
+              case TileClass::Sclera:
+                p = sclera.color;
+                break;
+              default:
+                p = pupilColor;
+                if (!irisEnd) {
+                  irisStart = screenY;
+                }
+                irisEnd = tileEnd;
+                break;
+            }
+            if (cachedAngle) {
+              // These colors don't depend on the angle, or on the exact distance
+              const uint16_t angle = tile == TileClass::Eyelid ? GeometryCache::eyelid : 0;
+              const uint8_t distance = tile == TileClass::Sclera ? 0 : 255;
+              std::fill(&cachedAngle[screenY], &cachedAngle[tileEnd], angle);
+              std::fill(&cachedDistance[screenY], &cachedDistance[tileEnd], distance);
+            }
+            pixel = std::fill_n(pixel, tileEnd - screenY, p);
+            screenY = tileEnd;
+            continue;
+          }
+
+#ifdef RENDER_PAIRS
+          // Shades one pixel of a pair, given its X displacement and where it lies on the polar maps
+          const auto shadeLane = [&](int32_t dx, int32_t mx, int32_t my, bool outside, uint32_t y) -> uint16_t {
+            if (dx == 255) {
+              // We're outside the eye area, i.e. this must be on an eyelid
+              if (cachedAngle) {
+                cachedAngle[y] = GeometryCache::eyelid;
+                cachedDistance[y] = 255;
               }
+              return eyelidColor;
+            }
+            uint32_t angle{};
+            int32_t distance{255};
+            if (!outside) {
+              lookup(mx, my, angle, distance);
+            }
+            if (cachedAngle) {
+              cachedAngle[y] = angle;
+              cachedDistance[y] = distance;
+            }
+            return shade([&] { trackIrisAt(y); }, angle, distance);
+          };
+
+          // Work on two pixels at a time for as long as the tile allows. A tile never spans both halves of
+          // the screen, so both pixels read the displacement map in the same direction.
+          for (; screenY + 1 < tileEnd; screenY += 2) {
+            const bool top = screenY < displacementMapSize;
+            const int32_t doff0 = top ? displacementMapSize - screenY - 1 : screenY - displacementMapSize;
+            const int32_t doff1 = top ? doff0 - 1 : doff0 + 1;
+            const int32_t dx0 = displaceX[doff0 * displacementMapSize];
+            const int32_t dx1 = displaceX[doff1 * displacementMapSize];
+            const simd::Pair dx = simd::pack(dx0, dx1);
+            const simd::Pair dy = simd::pack(displaceY[doff0], displaceY[doff1]);
+            const simd::Pair yy = simd::pack(yPositionOverMap + screenY, yPositionOverMap + screenY + 1);
+            const simd::Pair mx = xmul < 0 ? simd::sub(xxPair, dx) : simd::add(xxPair, dx);
+            const simd::Pair my = top ? simd::sub(yy, dy) : simd::add(yy, dy);
+
+            // Lanes that fall outside the polar maps are the back of the eye
+            simd::Pair outside{};
+            if constexpr (!guarded) {
+              outside = simd::selectBelow(mx, mapLimit, 0, 0xFFFFFFFF) | simd::selectBelow(my, mapLimit, 0, 0xFFFFFFFF);
             }
 
-            // Convert the polar angle/distance to texture map coordinates
-            if (distance < 128) {
-              // We're in the sclera
-              if (hasScleraTexture) {
-                angle = ((angle + eye.currentScleraAngle) & 1023) ^ sclera.mirror;
-                const int32_t tx = (angle & 1023) * sclera.texture.width / 1024; // Texture map x/y
-                const int32_t ty = distance * sclera.texture.height / 128;
-                p = sclera.texture.get(tx, ty);
-              } else {
-                p = sclera.color;
+            simd::Pair p;
+            if constexpr (scleraMode == TextureMode::Color && irisMode == TextureMode::Color) {
+              // Everything is a solid color, so the shading is just a series of thresholds on the distance.
+              // A distance of 256 marks an eyelid.
+              uint32_t angle0{}, angle1{};
+              int32_t distance0{256}, distance1{256};
+              if (dx0 < 255) {
+                distance0 = 255;
+                if (!simd::low(outside)) {
+                  lookup(simd::low(mx), simd::low(my), angle0, distance0);
+                }
               }
-            } else if (distance < 255) {
-              // Either the iris or pupil
-              if (distance >= irisSize) {
-                // Pupil
-                p = pupilColor;
-              } else {
-                // Iris
-                if (hasIrisTexture) {
-                  angle = ((angle + eye.currentIrisAngle) & 1023) ^ iris.mirror;
-                  const int32_t tx = (angle & 1023) * iris.texture.width / 1024;
-                  const int32_t ty = (distance - 128) * iPupilFactor / 32768;
-                  p = iris.texture.get(tx, ty);
-                } else {
-                  p = iris.color;
+              if (dx1 < 255) {
+                distance1 = 255;
+                if (!simd::high(outside)) {
+                  lookup(simd::high(mx), simd::high(my), angle1, distance1);
                 }
               }
+              if (cachedAngle) {
+                cachedAngle[screenY] = distance0 == 256 ? GeometryCache::eyelid : angle0;
+                cachedDistance[screenY] = std::min(distance0, 255);
+                cachedAngle[screenY + 1] = distance1 == 256 ? GeometryCache::eyelid : angle1;
+                cachedDistance[screenY + 1] = std::min(distance1, 255);
+              }
+              if (distance0 >= 128 && distance0 < 255) {
+                trackIrisAt(screenY);
+              }
+              if (distance1 >= 128 && distance1 < 255) {
+                trackIrisAt(screenY + 1);
+              }
+              const simd::Pair distance = simd::pack(distance0, distance1);
+              p = simd::selectBelow(distance, solidLimit, backPair, eyelidPair);
+              p = simd::selectBelow(distance, pupilLimit, pupilPair, p);
+              p = simd::selectBelow(distance, irisLimit, irisPair, p);
+              p = simd::selectBelow(distance, scleraLimit, scleraPair, p);
             } else {
-              // Back of eye
-              p = backColor;
+              // These must be shaded in order, so the iris is tracked correctly
+              const uint16_t p0 = shadeLane(dx0, simd::low(mx), simd::low(my), simd::low(outside), screenY);
+              const uint16_t p1 = shadeLane(dx1, simd::high(mx), simd::high(my), simd::high(outside), screenY + 1);
+              p = simd::pack(p0, p1);
             }
-          } else {
-            // We're outside the polar map so just use the back-of-eye color
-            p = backColor;
+            simd::store(pixel, p);
+            pixel += 2;
           }
-        } else {
-          // We're outside the eye area, i.e. this must be on an eyelid
-          p = eyelidColor;
-        }
-        display.drawPixel(screenX, screenY, p);
-      } // end column
+
+#endif
+          for (; screenY < tileEnd; screenY++) {
+              uint32_t p;
+
+              const int32_t yy = yPositionOverMap + screenY;
+              int32_t dx, dy;
+              if (screenY < displacementMapSize) {
+                // We're in the top half of the screen, so we need to vertically flip the displacement map lookup
+                doff = displacementMapSize - screenY - 1;
+                dy = -displaceY[doff];
+              } else {
+                // We're in the bottom half of the screen
+                doff = screenY - displacementMapSize;
+                dy = displaceY[doff];
+              }
+              dx = displaceX[doff * displacementMapSize];
+              if (dx < 255) {
+                // We're inside the eyeball (sclera/iris/pupil) area
+                dx *= xmul;  // Flip x offset sign if in left half of screen
+                uint32_t angle;
+                int32_t distance;
+                polar(xx + dx, yy + dy, angle, distance);
+                if (cachedAngle) {
+                  cachedAngle[screenY] = angle;
+                  cachedDistance[screenY] = distance;
+                }
+                p = shade(trackIris, angle, distance);
+              } else {
+                // We're outside the eye area, i.e. this must be on an eyelid
+                if (cachedAngle) {
+                  cachedAngle[screenY] = GeometryCache::eyelid;
+                  cachedDistance[screenY] = 255;
+                }
+                p = eyelidColor;
+              }
+              *pixel++ = p;
+          } // end tile
+        } // end column
+      }
+      if (maxY > minY) {
+        display.writeColumn(screenX, minY, maxY - minY, column);
+        drawn = true;
+      }
+      if (!irisOnly) {
+        damage.irisStart[screenX] = irisStart;
+        damage.irisEnd[screenX] = irisEnd;
+      }
     } // end scanline
+#endif
 
     eye.drawAll = false;
+    return drawn;
   }
 
   Eye<Disp> &currentEye() {
     return eyes[eyeIndex];
   }
 
+  /// Picks the eye to render next. All the eyes follow the same movements, so the longer an eye has gone
+  /// without being rendered, the more it has changed. The eye that has waited longest is chosen from those
+  /// whose displays are ready, so an eye whose display is still busy doesn't hold up the others.
+  /// \return the index of the eye to render, or numEyes if none should be rendered yet.
+  size_t nextEye() {
+    size_t next = numEyes;
+    for (size_t i = 0; i < numEyes; i++) {
+      if (waiting[i] >= maxWaiting) {
+        // This eye has been starved for too long, so it goes next whatever happens
+        return eyes[i].display->isAvailable() ? i : numEyes;
+      }
+      if ((next == numEyes || waiting[i] > waiting[next]) && eyes[i].display->isAvailable()) {
+        next = i;
+      }
+    }
+    return next;
+  }
+
 public:
   EyeController(std::array<DisplayDefinition<Disp>, numEyes> displayDefs, bool autoMove, bool autoBlink,
                 bool autoPupils) :
@@ -543,6 +1312,16 @@ public:
     }
   }
 
+  /// \return where the time and random numbers come from, for example to seed or advance them.
+  Timing &getTiming() {
+    return timing;
+  }
+
+  /// \return the timings of the recent frames. These are only recorded if PROFILE_FRAMES is defined.
+  FrameProfiler<> &getProfiler() {
+    return profiler;
+  }
+
   /// Enables or disables the automatic random eye movement.
   /// \param enabled true to enable automatic movement, false to disable it.
   void setAutoMove(bool enabled) {
@@ -582,17 +1361,47 @@ public:
     maxGazeMs = maxGazeMillis;
   }
 
+  /// Enables or disables the geometry cache. While the eyes hold their gaze this lets each frame skip
+  /// working out where every pixel falls on the polar maps, which mostly helps eyes that spin or have
+  /// a changing pupil size. It uses about 170KB of RAM per eye.
+  /// \param enabled true to enable the cache, false to disable it and free its memory.
+  /// \return true if the cache is enabled, false if it is disabled or there wasn't enough memory for it.
+  bool setGeometryCache(bool enabled) {
+    for (auto &eye: eyes) {
+      if (enabled && !eye.geometryCache) {
+        void *memory = malloc(sizeof(GeometryCache));
+        if (!memory) {
+          setGeometryCache(false);
+          return false;
+        }
+        eye.geometryCache = new(memory) GeometryCache();
+      } else if (!enabled && eye.geometryCache) {
+        free(eye.geometryCache);
+        eye.geometryCache = nullptr;
+      }
+    }
+    return enabled;
+  }
+
   /// Starts the blink process, if the eye(s) are not already blinking.
   void blink() {
+    nowMs = timing.millis();
     doBlink();
     state.timeToNextBlinkMs = 0;
   }
 
+  /// Holds the eyelids partly closed, for a sleepy look. Blinks still close the eyes fully.
+  /// \param amount how far the eyelids are closed, from 0 (fully open) to 1 (closed).
+  void setBlink(float amount) {
+    state.heldBlink = std::max(0.0f, std::min(1.0f, amount));
+  }
+
   /// Starts winking the eye at the given index. If the index is out of range or the eye
   /// is already winking or blinking, nothing will happen.
   void wink(size_t index) {
     if (index < eyes.size()) {
-      wink(eyes[index], random(50, 100));
+      nowMs = timing.millis();
+      wink(eyes[index], timing.random(50, 100));
     }
   }
 
@@ -612,7 +1421,7 @@ public:
     if (!state.inMotion) {
       state.inMotion = true;
       state.moveDurationMs = durationMs;
-      state.moveStartTimeMs = millis();
+      state.moveStartTimeMs = nowMs = timing.millis();
     }
   }
 
@@ -637,7 +1446,7 @@ public:
     state.resizeStart = state.pupilAmount;
     state.resizeTarget = ratio;
     state.resizeDurationMs = durationMs;
-    state.resizeStartTimeMs = millis();
+    state.resizeStartTimeMs = nowMs = timing.millis();
   }
 
   /// Instantly resizes the pupils to the specified size. In real eyes, both pupils react
@@ -660,16 +1469,25 @@ public:
   }
 
   /// Renders a single frame of animation. If there is more than one eye defined,
-  /// only a single eye/display will be updated.
-  /// \return true if the rendering took place, false if it didn't (for example, because
-  /// the display was not yet ready for drawing on because it is still asynchronously
-  /// drawing the previous frame).
+  /// only a single eye/display will be updated, chosen by nextEye().
+  /// \return true if the frame was handled (including when the eye hadn't changed so nothing
+  /// needed drawing), false if it wasn't (for example, because no display was ready for
+  /// drawing on because they are all still asynchronously drawing their previous frames).
   bool renderFrame() {
-    auto &eye = currentEye();
-
-    if (!eye.display->isAvailable()) {
+    profiler.begin();
+    const size_t next = nextEye();
+    if (next == numEyes) {
+      profiler.idle();
       return false;
     }
+    profiler.mark(FramePhase::Wait);
+    eyeIndex = next;
+    nowMs = timing.millis();
+    for (auto &w: waiting) {
+      w++;
+    }
+    waiting[eyeIndex] = 0;
+    auto &eye = currentEye();
 
     // Apply any automated eye/eyelid/pupil movements
     applyAutoMove(eye);
@@ -677,26 +1495,30 @@ public:
     applyAutoPupils();
 
     // Apply any time-based changes
-    auto blinkFactor = updateBlinkState(eye);
+    auto blinkFactor = std::max(updateBlinkState(eye), state.heldBlink);
     applyFixation(eye);
     applySpin(eye);
+    profiler.mark(FramePhase::Behaviour);
 
     const std::pair<float, float> &pair = computeEyelids(eye);
     //auto [upperQ, lowerQ] = computeEyelids(eye);
     auto upperQ = pair.first;
     auto lowerQ = pair.second;
+    profiler.mark(FramePhase::Eyelids);
 
     // Draw the eye. We temporarily flip the X value if this is the right eye, since it is mirrored
     if (eyeIndex == 0) eye.x = eye.definition->polar.mapRadius * 2 - eye.x;
-    renderEye(eye, upperQ, lowerQ, blinkFactor);
+    const bool changed = (this->*kernel(eye.kernel, withinGuard(eye)))(eye, upperQ, lowerQ, blinkFactor);
     // Flip it back
     if (eyeIndex == 0) eye.x = eye.definition->polar.mapRadius * 2 - eye.x;
+    profiler.mark(FramePhase::Render);
 
-    // Send the updated eye to its screen
-    eye.display->update();
-
-    // Advance to the next eye for the next frame
-    eyeIndex = (eyeIndex + 1) % eyes.size();
+    // Send the updated eye to its screen, unless nothing about it has changed
+    if (changed) {
+      eye.display->update(changedRows);
+    }
+    profiler.mark(FramePhase::Update);
+    profiler.end(eyeIndex, changed);
 
     return true;
   }
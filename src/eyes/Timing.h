@@ -0,0 +1,70 @@
+#pragma once
+
+#include <Arduino.h>
+
+/// A small, fast pseudo random number generator (xorshift32). It takes a few cycles per number, and the
+/// same seed always gives the same sequence on every platform.
+class XorShift32 {
+private:
+  uint32_t state{1};
+
+public:
+  XorShift32() = default;
+
+  explicit XorShift32(uint32_t seed) {
+    this->seed(seed);
+  }
+
+  /// Restarts the sequence. A seed of 0 is treated as 1, since xorshift never leaves 0.
+  void seed(uint32_t seed) {
+    state = seed ? seed : 1;
+  }
+
+  uint32_t next() {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+  }
+
+  /// \return a number from 0 up to (but not including) howbig, or 0 if howbig is 0.
+  uint32_t random(uint32_t howbig) {
+    return howbig ? next() % howbig : 0;
+  }
+
+  /// \return a number from howsmall up to (but not including) howbig, or howsmall if the range is empty.
+  int32_t random(int32_t howsmall, int32_t howbig) {
+    if (howsmall >= howbig) {
+      return howsmall;
+    }
+    return static_cast<int32_t>(random(static_cast<uint32_t>(howbig - howsmall))) + howsmall;
+  }
+};
+
+/// Where an EyeController gets the time and its random numbers from on real hardware: the Arduino
+/// millisecond clock, and an XorShift32 seeded from Arduino's random(), so randomSeed() still applies
+/// as long as it's called before the EyeController is created.
+class ArduinoTiming : public XorShift32 {
+public:
+  ArduinoTiming() : XorShift32(::random(UINT32_MAX)) {}
+
+  uint32_t millis() const {
+    return ::millis();
+  }
+};
+
+/// Time and random numbers for running an EyeController faster (or slower) than real time, such as in
+/// benchmarks and tests. Time only moves on when advance() is called, so runs are repeatable.
+class SimulatedTiming : public XorShift32 {
+public:
+  /// The current simulated time, in milliseconds
+  uint32_t nowMs{};
+
+  uint32_t millis() const {
+    return nowMs;
+  }
+
+  void advance(uint32_t ms) {
+    nowMs += ms;
+  }
+};
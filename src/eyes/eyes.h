@@ -5,7 +5,9 @@
 #pragma GCC diagnostic ignored "-Wpsabi"
 
 #include <Arduino.h>
+#include <array>
 
+// The size of a single eye. When both eyes share one larger panel, each is drawn at this size into a Viewport.
 constexpr uint16_t screenWidth = 240;
 constexpr uint16_t screenHeight = 240;
 
@@ -44,6 +46,9 @@ struct OverallState {
   uint32_t resizeDurationMs{};
 
   int fixate{7};
+
+  /// How far the eyelids are held closed, on top of any blinking. 0 = fully open, 1 = closed.
+  float heldBlink{};
 };
 
 enum class BlinkState {
@@ -58,6 +63,43 @@ struct EyeBlink {
   float blinkFactor{};    // The most recent amount of blink [0..1] that was applied. 0 = not blinking, 1 = full blink
 };
 
+/// How the iris or sclera is shaded. This is fixed for the life of an EyeDefinition, so it is
+/// used to pick a rendering kernel that is specialised for the eye, rather than testing it per pixel.
+enum class TextureMode : uint8_t {
+  Color,    // A flat color, no texture
+  Texture,  // A texture with no rotation or mirroring
+  Rotated   // A texture that spins, has a start angle and/or is mirrored
+};
+
+/// Precomputed texture coordinates for an iris or sclera texture, so the renderer can turn
+/// polar angle/distance values into texel offsets without multiplying and dividing for each pixel.
+struct TextureLookup {
+  /// The texture X coordinate for each polar angle (0-1023)
+  std::array<uint16_t, 1024> column{};
+  /// The offset of the start of the texture row for each polar distance (0-127)
+  std::array<uint32_t, 128> row{};
+
+  /// Maps the polar angles onto the full width of a texture.
+  void setColumns(const Image &texture) {
+    for (uint32_t angle = 0; angle < column.size(); angle++) {
+      column[angle] = angle * texture.width / 1024;
+    }
+  }
+
+  /// Maps polar distances onto texture rows.
+  /// \param texture the texture to map the distances onto.
+  /// \param factor the scale applied to each distance to give a row, multiplied by 32768.
+  void setRows(const Image &texture, int32_t factor) {
+    for (int32_t distance = 0; distance < static_cast<int32_t>(row.size()); distance++) {
+      row[distance] = distance * factor / 32768 * texture.width;
+    }
+  }
+
+  inline uint16_t get(const Image &texture, uint32_t angle, uint32_t distance) const __attribute__((always_inline)) {
+    return texture.data[row[distance] + column[angle]];
+  }
+};
+
 struct PupilParams {
   /// 16-bit 565 RGB, big-endian
   const uint16_t color{};
@@ -88,6 +130,13 @@ struct IrisParams {
   bool hasTexture() const {
     return texture.data != nullptr;
   }
+
+  TextureMode textureMode() const {
+    if (!hasTexture()) {
+      return TextureMode::Color;
+    }
+    return startAngle || spin != 0.0f || iSpin || mirror ? TextureMode::Rotated : TextureMode::Texture;
+  }
 };
 
 struct ScleraParams {
@@ -107,6 +156,13 @@ struct ScleraParams {
   bool hasTexture() const {
     return texture.data != nullptr;
   }
+
+  TextureMode textureMode() const {
+    if (!hasTexture()) {
+      return TextureMode::Color;
+    }
+    return startAngle || spin != 0.0f || iSpin || mirror ? TextureMode::Rotated : TextureMode::Texture;
+  }
 };
 
 struct EyelidParams {
@@ -170,6 +226,13 @@ struct PolarParams {
   uint16_t mapRadius{240};  // Pixels
   const uint8_t *angle{};
   const uint8_t *distance{};
+  /// Optional interleaved version of the angle and distance maps. Each entry holds the distance in the
+  /// high byte and the angle in the low byte, and entries are stored column by column so the renderer
+  /// reads them sequentially in every quadrant. When present, angle and distance aren't used.
+  const uint16_t *map{};
+  /// The width of the guard band that pads the far edges of each quadrant of the maps, or zero if there
+  /// isn't one. The band reads as the back of the eye, and lets the renderer skip its bounds checks.
+  uint16_t guard{};
 };
 
 struct EyeDefinition {
@@ -186,6 +249,69 @@ struct EyeDefinition {
   PolarParams polar{};
 };
 
+/// The renderer divides the screen into square tiles of this size. Any tile that is entirely one
+/// solid color is filled without working out each of its pixels.
+constexpr uint16_t tileSize = 8;
+constexpr uint16_t tileColumns = screenWidth / tileSize;
+constexpr uint16_t tileRows = screenHeight / tileSize;
+
+enum class TileClass : uint8_t {
+  Mixed,   // Needs rendering pixel by pixel
+  Eyelid,  // Entirely outside the eyeball
+  Back,    // Entirely outside the polar maps (the back of the eye)
+  Sclera,  // Entirely within a sclera that has no texture
+  Pupil    // Entirely within a round pupil
+};
+
+/// The area of the polar maps that a tile covers, given as offsets from the gaze position.
+struct TileBounds {
+  int16_t minX{};
+  int16_t maxX{};
+  int16_t minY{};
+  int16_t maxY{};
+  /// The number of the tile's pixels that lie outside the eyeball
+  uint8_t outside{};
+};
+
+/// Per-definition data that's used to classify the tiles each frame.
+struct TileMap {
+  /// The bounds of each tile, stored column by column
+  std::array<TileBounds, tileColumns * tileRows> bounds{};
+  /// The radius of the iris in polar map pixels
+  float irisRadius{};
+};
+
+/// Records what an eye looked like when it was last drawn, so the next frame can work out
+/// which parts of the screen actually need redrawing.
+struct DamageState {
+  /// The integer gaze position over the polar maps
+  int32_t x{};
+  int32_t y{};
+  /// The pupil size, as the distance map threshold and the iris texture scale factor
+  int32_t irisSize{};
+  int32_t pupilFactor{};
+  uint16_t irisAngle{};
+  uint16_t scleraAngle{};
+  /// The rows [start, end) of each column that contained iris or pupil pixels
+  std::array<uint8_t, screenWidth> irisStart{};
+  std::array<uint8_t, screenWidth> irisEnd{};
+};
+
+/// Caches the polar angle and distance that each screen pixel resolved to for the current gaze
+/// position. While the eye holds its gaze, this lets frames skip the displacement and polar map
+/// lookups and go straight to shading. Pixels are stored column by column.
+struct GeometryCache {
+  /// The angle stored for pixels that lie outside the eyeball, i.e. on the eyelids
+  static constexpr uint16_t eyelid{0xFFFF};
+  /// The polar angle (0-1023) of each pixel
+  uint16_t angle[screenWidth * screenHeight];
+  /// The polar distance of each pixel. 255 means the back of the eye, or eyelid if the angle says so.
+  uint8_t distance[screenWidth * screenHeight];
+  /// The rows [start, end) of each column that hold valid entries for the current gaze position
+  std::array<uint8_t, screenWidth> start{};
+  std::array<uint8_t, screenWidth> end{};
+};
+
 /// One-per-eye structure. Mutable, holding the current state of an eye/display.
 template <typename Disp>
 struct Eye {
@@ -202,6 +328,19 @@ struct Eye {
   float upperLidFactor{};
   float lowerLidFactor{};
   bool drawAll{};
+  /// Index of the rendering kernel that is specialised for this eye's definition
+  uint8_t kernel{};
+  /// Texture coordinate lookups. The sclera and iris columns are fixed for the definition, while
+  /// the iris rows depend on the size of the pupil.
+  TextureLookup scleraLookup{};
+  TextureLookup irisLookup{};
+  /// The pupil scale factor that irisLookup's rows were last calculated for
+  int32_t irisRowFactor{-1};
+  /// What was drawn last frame
+  DamageState damage{};
+  /// Optional cache of the eye's geometry, see EyeController::setGeometryCache()
+  GeometryCache *geometryCache{};
+  TileMap tiles{};
 };
 
 template <typename Disp>
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <Arduino.h>
+
+extern const uint8_t polarAngle_240_g86[];
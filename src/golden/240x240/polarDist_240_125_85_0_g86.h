@@ -0,0 +1,5 @@
+#pragma once
+
+#include <Arduino.h>
+
+extern const uint8_t polarDist_240_125_85_0_g86[];
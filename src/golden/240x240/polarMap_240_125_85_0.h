@@ -0,0 +1,5 @@
+#pragma once
+
+#include <Arduino.h>
+
+extern const uint16_t polarMap_240_125_85_0[];
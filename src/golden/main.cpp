@@ -0,0 +1,337 @@
+// Golden-frame regression test for the renderer. Drives an EyeController through a fixed script of
+// saccades, blinks, pupil resizes and eye switches, with simulated time and a seeded random number
+// generator, and checks a hash of every frame against the hashes recorded in frames.golden.
+//
+// Usage: program [check|record] [options]
+//   check                 compare every frame with the golden hashes (the default)
+//   record                write new golden hashes, after a deliberate change to the rendering
+//   --golden <file>       the golden hash file (default src/golden/frames.golden)
+//   --frames <dir>        when recording, also save every frame as <dir>/<eye>-<frame>-golden.ppm
+//   --diff <dir>          when checking, save each mismatching frame as <dir>/<eye>-<frame>-actual.ppm,
+//                         plus <eye>-<frame>-diff.ppm marking the changed pixels in red, if a golden
+//                         frame saved with --frames is in the same directory
+//   --eye <name>          only run the given eye, along with any map variants of it
+//   --cache               render with the geometry cache enabled
+// Build with -D RENDER_ROWS, -D RENDER_PAIRS or -D STREAM_STRIPS to check the other renderers, which
+// must all match the same golden hashes.
+//
+// Some eyes are also run with their polar maps regenerated by tablegen.py in another format, see
+// mapVariants. These have golden hashes of their own, and must draw exactly the same frames as the eye
+// they were generated from.
+
+// Build the kernels for guard-banded polar maps, as including a tablegen.py eye with a guard band would
+#define GUARDED_POLAR_MAPS
+
+#include <cinttypes>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../displays/RamDisplay.h"
+#include "../eyes/EyeController.h"
+
+#include "../eyes/240x240/anime.h"
+#include "../eyes/240x240/bigBlue.h"
+#include "../eyes/240x240/blueFlame1.h"
+#include "../eyes/240x240/blueFlame2.h"
+#include "../eyes/240x240/brown.h"
+#include "../eyes/240x240/cat.h"
+#include "../eyes/240x240/demon.h"
+#include "../eyes/240x240/doe.h"
+#include "../eyes/240x240/doomRed.h"
+#include "../eyes/240x240/doomSpiral.h"
+#include "../eyes/240x240/dragon.h"
+#include "../eyes/240x240/firebox.h"
+#include "../eyes/240x240/fish.h"
+#include "../eyes/240x240/fizzgig.h"
+#include "../eyes/240x240/flame.h"
+#include "../eyes/240x240/hazel.h"
+#include "../eyes/240x240/hypnoRed.h"
+#include "../eyes/240x240/leopard.h"
+#include "../eyes/240x240/newt.h"
+#include "../eyes/240x240/skull.h"
+#include "../eyes/240x240/snake.h"
+#include "../eyes/240x240/spikes.h"
+#include "../eyes/240x240/toonstripe.h"
+
+#include "240x240/polarAngle_240_g86.h"
+#include "240x240/polarDist_240_125_85_0_g86.h"
+#include "240x240/polarMap_240_125_85_0.h"
+
+using Controller = EyeController<2, RamDisplay, SimulatedTiming>;
+
+std::array<std::array<EyeDefinition, 2>, 23> goldenEyes{{
+    {anime::left, anime::right}, {bigBlue::eye, bigBlue::eye}, {blueFlame1::eye, blueFlame1::eye},
+    {blueFlame2::eye, blueFlame2::eye}, {brown::eye, brown::eye}, {cat::eye, cat::eye},
+    {demon::left, demon::right}, {doe::left, doe::right}, {doomRed::eye, doomRed::eye},
+    {doomSpiral::left, doomSpiral::right}, {dragon::eye, dragon::eye}, {firebox::eye, firebox::eye},
+    {fish::eye, fish::eye}, {fizzgig::eye, fizzgig::eye}, {flame::eye, flame::eye}, {hazel::eye, hazel::eye},
+    {hypnoRed::eye, hypnoRed::eye}, {leopard::left, leopard::right}, {newt::eye, newt::eye},
+    {skull::eye, skull::eye}, {snake::eye, snake::eye}, {spikes::eye, spikes::eye},
+    {toonstripe::eye, toonstripe::eye},
+}};
+
+/// One of the goldenEyes with its polar maps regenerated in another of tablegen.py's formats. Only the
+/// maps are kept from the generated code, the rest of the eye is the same as the one in goldenEyes.
+struct MapVariant {
+  /// The name its golden hashes are recorded under
+  const char *name;
+  /// The index in goldenEyes of the eye it was generated from
+  size_t base;
+  PolarParams polar;
+};
+
+const MapVariant mapVariants[] = {
+    // python tablegen.py <dir> bigBlue/config.eye interleaved
+    {"bigBlue-map", 1, {240, nullptr, nullptr, polarMap_240_125_85_0}},
+    // python tablegen.py <dir> bigBlue/config.eye separate auto
+    {"bigBlue-guard", 1, {240, polarAngle_240_g86, polarDist_240_125_85_0_g86, nullptr, 86}},
+};
+
+/// The number of frames rendered for each eye
+constexpr uint32_t FRAMES_PER_EYE{120};
+
+/// The simulated time between frames. It's deliberately not a round number, so the eyes don't
+/// land on the same point of every animation each frame.
+constexpr uint32_t FRAME_MS{7};
+
+/// Something the script does to the controller just before a given frame of each eye is rendered
+struct ScriptStep {
+  uint32_t frame;
+  void (*action)(Controller &);
+};
+
+/// The frame at which each eye's run switches over to the next eye in goldenEyes
+constexpr uint32_t SWITCH_FRAME{105};
+
+// The random movement, blinking and pupils run throughout, apart from where the script takes over
+const ScriptStep script[] = {
+    {10, [](Controller &c) { c.setAutoMove(false); c.setTargetPosition(-0.9f, 0.2f, 100); }},
+    {30, [](Controller &c) { c.setTargetPosition(0.8f, -0.6f, 60); }},
+    {45, [](Controller &c) { c.blink(); }},
+    {60, [](Controller &c) { c.setAutoPupils(false); c.setTargetPupil(1.0f, 150); }},
+    {75, [](Controller &c) { c.setTargetPupil(0.0f, 80); c.wink(1); }},
+    {85, [](Controller &c) { c.setBlink(0.4f); c.setPosition(0.0f, 1.0f); }},
+    {95, [](Controller &c) { c.setBlink(0.0f); c.setAutoMove(true); c.setAutoPupils(true); }},
+};
+
+static uint64_t hashFrame(const std::array<RamDisplay *, 2> &displays) {
+  // FNV-1a
+  uint64_t hash = 14695981039346656037ULL;
+  for (RamDisplay *display: displays) {
+    const uint16_t *pixels = display->frameBuffer();
+    for (uint32_t i = 0; i < RamDisplay::width * RamDisplay::height; i++) {
+      hash = (hash ^ pixels[i]) * 1099511628211ULL;
+    }
+  }
+  return hash;
+}
+
+/// Reads the pixels of a PPM written by RamDisplay::writePpm().
+static bool readPpm(const std::string &path, std::vector<uint8_t> &rgb) {
+  FILE *file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  int width, height, depth;
+  const bool ok = fscanf(file, "P6 %d %d %d", &width, &height, &depth) == 3 && fgetc(file) != EOF;
+  rgb.resize(ok ? width * height * 3 : 0);
+  const bool read = ok && fread(rgb.data(), 1, rgb.size(), file) == rgb.size();
+  fclose(file);
+  return read;
+}
+
+/// Writes a copy of the actual frame, dimmed, with the pixels that differ from the golden frame in red.
+/// \return the number of pixels that differ, or -1 if the frames couldn't be read.
+static int32_t writeDiff(const std::string &golden, const std::string &actual, const std::string &diff) {
+  std::vector<uint8_t> expected, got;
+  if (!readPpm(golden, expected) || !readPpm(actual, got) || expected.size() != got.size()) {
+    return -1;
+  }
+  int32_t changed = 0;
+  for (size_t i = 0; i < got.size(); i += 3) {
+    if (memcmp(&expected[i], &got[i], 3) != 0) {
+      got[i] = 255;
+      got[i + 1] = got[i + 2] = 0;
+      changed++;
+    } else {
+      got[i] /= 3;
+      got[i + 1] /= 3;
+      got[i + 2] /= 3;
+    }
+  }
+  FILE *file = fopen(diff.c_str(), "wb");
+  if (!file) {
+    return -1;
+  }
+  fprintf(file, "P6\n%d %d\n255\n", RamDisplay::width * 2, RamDisplay::height);
+  fwrite(got.data(), 1, got.size(), file);
+  fclose(file);
+  return changed;
+}
+
+int main(int argc, char **argv) {
+  bool record = false, cache = false;
+  std::string goldenPath = "src/golden/frames.golden", framesDir, diffDir, onlyEye;
+  for (int i = 1; i < argc; i++) {
+    const std::string arg = argv[i];
+    const bool hasValue = i + 1 < argc;
+    if (arg == "record") {
+      record = true;
+    } else if (arg == "check") {
+      record = false;
+    } else if (arg == "--cache") {
+      cache = true;
+    } else if (arg == "--golden" && hasValue) {
+      goldenPath = argv[++i];
+    } else if (arg == "--frames" && hasValue) {
+      framesDir = argv[++i];
+    } else if (arg == "--diff" && hasValue) {
+      diffDir = argv[++i];
+    } else if (arg == "--eye" && hasValue) {
+      onlyEye = argv[++i];
+    } else {
+      fprintf(stderr, "Unknown argument %s\n", arg.c_str());
+      return 2;
+    }
+  }
+
+  // The golden hashes, by eye name and frame
+  std::map<std::string, std::vector<uint64_t>> golden;
+  if (!record) {
+    FILE *file = fopen(goldenPath.c_str(), "r");
+    if (!file) {
+      fprintf(stderr, "Couldn't read %s\n", goldenPath.c_str());
+      return 2;
+    }
+    char name[32];
+    uint32_t frame;
+    uint64_t hash;
+    while (fscanf(file, "%31s %" SCNu32 " %" SCNx64, name, &frame, &hash) == 3) {
+      auto &hashes = golden[name];
+      hashes.resize(std::max<size_t>(hashes.size(), frame + 1));
+      hashes[frame] = hash;
+    }
+    fclose(file);
+  }
+
+  FILE *out = nullptr;
+  if (record) {
+    out = fopen(goldenPath.c_str(), "w");
+    if (!out) {
+      fprintf(stderr, "Couldn't write %s\n", goldenPath.c_str());
+      return 2;
+    }
+  }
+
+  // Every golden eye, then each map variant
+  struct Run {
+    std::string name;
+    size_t base;
+    std::array<EyeDefinition, 2> defs;
+  };
+  std::vector<Run> runs;
+  for (size_t eye = 0; eye < goldenEyes.size(); eye++) {
+    runs.push_back(Run{goldenEyes[eye][0].name, eye, goldenEyes[eye]});
+  }
+  for (const MapVariant &variant: mapVariants) {
+    Run run{variant.name, variant.base, goldenEyes[variant.base]};
+    for (EyeDefinition &def: run.defs) {
+      def.polar = variant.polar;
+    }
+    runs.push_back(run);
+  }
+
+  // The hashes of every frame drawn so far, so each map variant can be compared with its base eye
+  std::map<std::string, std::vector<uint64_t>> drawn;
+  uint32_t failedEyes = 0;
+  for (Run &run: runs) {
+    const std::string &name = run.name;
+    const std::string baseName = goldenEyes[run.base][0].name;
+    auto &defs = run.defs;
+    if (!onlyEye.empty() && name != onlyEye && baseName != onlyEye) {
+      continue;
+    }
+    // Every eye starts from scratch, so its frames don't depend on which eyes ran before it. A new
+    // controller's SimulatedTiming starts at time 0, with the random numbers seeded with 1.
+    const std::unique_ptr<RamDisplay> left(new RamDisplay(true)), right(new RamDisplay(false));
+    const std::array<RamDisplay *, 2> displays{left.get(), right.get()};
+    Controller controller({DisplayDefinition<RamDisplay>{displays[0], defs[0]},
+                           DisplayDefinition<RamDisplay>{displays[1], defs[1]}}, true, true, true);
+    if (cache && !controller.setGeometryCache(true)) {
+      fprintf(stderr, "Not enough memory for the geometry cache\n");
+      return 2;
+    }
+
+    const std::vector<uint64_t> &expected = golden[name];
+    uint32_t mismatches = 0;
+    int32_t firstMismatch = -1;
+    const ScriptStep *step = script;
+    for (uint32_t frame = 0; frame < FRAMES_PER_EYE; frame++) {
+      for (; step != std::end(script) && step->frame == frame; step++) {
+        step->action(controller);
+      }
+      if (frame == SWITCH_FRAME) {
+        controller.updateDefinitions(goldenEyes[(run.base + 1) % goldenEyes.size()]);
+      }
+      controller.getTiming().advance(FRAME_MS);
+      controller.renderFrame();
+      const uint64_t hash = hashFrame(displays);
+      drawn[name].push_back(hash);
+      const std::string prefix = name + "-" + std::to_string(frame);
+      const std::array<const RamDisplay *, 2> frameDisplays{displays[0], displays[1]};
+
+      if (record) {
+        fprintf(out, "%s %" PRIu32 " %016" PRIx64 "\n", name.c_str(), frame, hash);
+        if (!framesDir.empty()) {
+          RamDisplay::writePpm((framesDir + "/" + prefix + "-golden.ppm").c_str(), frameDisplays);
+        }
+        continue;
+      }
+      if (frame < expected.size() && expected[frame] == hash) {
+        continue;
+      }
+      mismatches++;
+      if (firstMismatch < 0) {
+        firstMismatch = static_cast<int32_t>(frame);
+      }
+      if (!diffDir.empty()) {
+        const std::string actual = diffDir + "/" + prefix + "-actual.ppm";
+        RamDisplay::writePpm(actual.c_str(), frameDisplays);
+        const int32_t changed = writeDiff(diffDir + "/" + prefix + "-golden.ppm", actual,
+                                          diffDir + "/" + prefix + "-diff.ppm");
+        if (changed >= 0) {
+          printf("  %s: %d pixels differ\n", prefix.c_str(), changed);
+        }
+      }
+    }
+    controller.setGeometryCache(false);
+
+    // A map variant must match its base eye, whether checking or recording
+    if (name != baseName && drawn.count(baseName) && drawn[name] != drawn[baseName]) {
+      failedEyes++;
+      printf("%-14s FAIL  differs from %s, whose polar maps it was generated from\n", name.c_str(),
+             baseName.c_str());
+      continue;
+    }
+    if (!record) {
+      if (mismatches) {
+        failedEyes++;
+        printf("%-14s FAIL  %u of %u frames differ, starting at frame %d\n", name.c_str(), mismatches,
+               FRAMES_PER_EYE, firstMismatch);
+      } else {
+        printf("%-14s OK\n", name.c_str());
+      }
+    }
+  }
+
+  if (record) {
+    fclose(out);
+    printf("Recorded %s\n", goldenPath.c_str());
+    return failedEyes ? 1 : 0;
+  }
+  printf(failedEyes ? "%u eyes FAILED\n" : "All eyes match\n", failedEyes);
+  return failedEyes ? 1 : 0;
+}
@@ -78,6 +78,13 @@ void nextEye() {
 
 /// MAIN LOOP -- runs continuously after setup() ----------------------------
 void loop() {
+#ifdef PROFILE_FRAMES
+  // Send a 'p' over Serial to print the timings of the recent frames
+  if (Serial.available() && Serial.read() == 'p') {
+    eyes->getProfiler().dump();
+  }
+#endif
+
   // Switch eyes periodically
   static elapsedMillis eyeTime{};
   if (eyeTime > EYE_DURATION_MS) {
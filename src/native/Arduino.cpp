@@ -0,0 +1,50 @@
+#include "Arduino.h"
+
+NativeSerial Serial;
+
+static uint32_t currentMillis{};
+static uint32_t seed{1};
+
+uint32_t millis() {
+  return currentMillis;
+}
+
+uint32_t micros() {
+  return currentMillis * 1000;
+}
+
+void setMillis(uint32_t ms) {
+  currentMillis = ms;
+}
+
+void delay(uint32_t ms) {
+  currentMillis += ms;
+}
+
+void delayMicroseconds(uint32_t) {}
+
+void randomSeed(uint32_t newSeed) {
+  seed = newSeed ? newSeed : 1;
+}
+
+static uint32_t nextRandom() {
+  // xorshift32, so every run with the same seed is the same
+  seed ^= seed << 13;
+  seed ^= seed >> 17;
+  seed ^= seed << 5;
+  return seed;
+}
+
+uint32_t random(uint32_t howbig) {
+  if (howbig == 0) {
+    return 0;
+  }
+  return nextRandom() % howbig;
+}
+
+int32_t random(int32_t howsmall, int32_t howbig) {
+  if (howsmall >= howbig) {
+    return howsmall;
+  }
+  return random(static_cast<uint32_t>(howbig - howsmall)) + howsmall;
+}
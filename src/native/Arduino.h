@@ -0,0 +1,103 @@
+#pragma once
+
+// Just enough of the Arduino/Teensyduino API for the renderer to build and run on a desktop machine.
+// Time doesn't pass on its own here; the native main() moves it on with setMillis(), so runs are repeatable.
+
+#include <cstdint>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+#define PROGMEM
+#define DMAMEM
+#define FASTRUN
+#define FLASHMEM
+
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define LOW 0
+#define HIGH 1
+
+class __FlashStringHelper;
+#define F(string_literal) (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+uint32_t millis();
+uint32_t micros();
+void setMillis(uint32_t ms);
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+
+void randomSeed(uint32_t seed);
+uint32_t random(uint32_t howbig);
+int32_t random(int32_t howsmall, int32_t howbig);
+
+inline void pinMode(uint8_t, uint8_t) {}
+inline void digitalWrite(uint8_t, uint8_t) {}
+inline int digitalRead(uint8_t) { return HIGH; }
+inline int analogRead(uint8_t) { return 512; }
+
+/// Writes to stdout
+class NativeSerial {
+public:
+  void begin(uint32_t) {}
+  void flush() { fflush(stdout); }
+  explicit operator bool() const { return true; }
+
+  void print(const char *s) { fputs(s, stdout); }
+  void print(const __FlashStringHelper *s) { print(reinterpret_cast<const char *>(s)); }
+  void print(char c) { putchar(c); }
+  void print(int n) { printf("%d", n); }
+  void print(unsigned int n) { printf("%u", n); }
+  void print(long n) { printf("%ld", n); }
+  void print(unsigned long n) { printf("%lu", n); }
+  void print(double n, int digits = 2) { printf("%.*f", digits, n); }
+
+  template<typename T>
+  void println(T value) {
+    print(value);
+    println();
+  }
+
+  void println(double n, int digits) {
+    print(n, digits);
+    println();
+  }
+
+  void println() { putchar('\n'); }
+
+  template<typename... Args>
+  void printf(const char *format, Args... args) { ::printf(format, args...); }
+};
+
+extern NativeSerial Serial;
+
+/// Milliseconds since it was created or last assigned to, as on the Teensy
+class elapsedMillis {
+private:
+  uint32_t ms;
+
+public:
+  elapsedMillis(uint32_t value = 0) : ms(millis() - value) {}
+  operator uint32_t() const { return millis() - ms; }
+  elapsedMillis &operator=(uint32_t value) {
+    ms = millis() - value;
+    return *this;
+  }
+};
+
+/// Microseconds since it was created or last assigned to, as on the Teensy
+class elapsedMicros {
+private:
+  uint32_t us;
+
+public:
+  elapsedMicros(uint32_t value = 0) : us(micros() - value) {}
+  operator uint32_t() const { return micros() - us; }
+  elapsedMicros &operator=(uint32_t value) {
+    us = micros() - value;
+    return *this;
+  }
+};
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdio>
+#include <cstdint>
+
+// The pass/fail tally shared by the native check programs (src/bus, src/calibration and src/timing). Each
+// check is reported as it's made, and the program's exit code says whether any failed.
+
+/// The number of checks that have failed so far
+inline uint32_t failures = 0;
+
+/// Records the result of a check, printing it if it failed, or every result if verbose is true.
+/// \param ok whether the check passed.
+/// \param what a description of what was checked.
+/// \param verbose true to print the checks that pass as well.
+inline void check(bool ok, const char *what, bool verbose = true) {
+  if (verbose || !ok) {
+    printf("%-4s %s\n", ok ? "OK" : "FAIL", what);
+  }
+  if (!ok) {
+    failures++;
+  }
+}
+
+/// Prints a summary of the checks.
+/// \return the exit code for the program, 1 if any check failed.
+inline int checkResult() {
+  printf(failures ? "%u checks FAILED\n" : "All checks passed\n", failures);
+  return failures ? 1 : 0;
+}
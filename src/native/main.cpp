@@ -0,0 +1,54 @@
+// Runs every eye in config.h's eyeDefinitions on RAM displays, as fast as the host machine allows.
+// Usage: program [frames per eye] [directory to save the last frame of each eye to, as PPM]
+
+#include <chrono>
+#include <cstdlib>
+#include <string>
+
+#include "../config.h"
+
+/// The simulated time between frames. This only affects how far the eyes move, not how fast they run.
+constexpr uint32_t FRAME_MS{10};
+
+int main(int argc, char **argv) {
+  const uint32_t frames = argc > 1 ? strtoul(argv[1], nullptr, 10) : 300;
+  const char *outDir = argc > 2 ? argv[2] : nullptr;
+
+  setMillis(0);
+  randomSeed(1);
+  initEyes(true, true, true);
+
+  double totalSeconds = 0;
+  uint32_t totalFrames = 0;
+  for (size_t i = 0; i < eyeDefinitions.size(); i++) {
+    auto &defs = eyeDefinitions.at(i);
+    eyes->updateDefinitions(defs);
+    const uint32_t updatesBefore = ramDisplays[0]->updates + ramDisplays[1]->updates;
+    const auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 0; frame < frames; frame++) {
+      setMillis(millis() + FRAME_MS);
+      eyes->renderFrame();
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const uint32_t drawn = ramDisplays[0]->updates + ramDisplays[1]->updates - updatesBefore;
+    totalSeconds += seconds;
+    totalFrames += frames;
+    printf("%-16s %6u frames (%u drawn) %8.1f fps %8.3f ms/frame\n", defs[0].name, frames, drawn,
+           frames / seconds, seconds * 1000 / frames);
+
+    if (outDir) {
+      const std::string path = std::string(outDir) + "/" + defs[0].name + ".ppm";
+      if (!RamDisplay::writePpm(path.c_str(), std::array<const RamDisplay *, 2>{ramDisplays[0], ramDisplays[1]})) {
+        fprintf(stderr, "Couldn't write %s\n", path.c_str());
+        return 1;
+      }
+    }
+  }
+  printf("%-16s %6u frames %17.1f fps %8.3f ms/frame\n", "total", totalFrames, totalFrames / totalSeconds,
+         totalSeconds * 1000 / totalFrames);
+#ifdef PROFILE_FRAMES
+  // The last eye's most recent frames
+  eyes->getProfiler().dump();
+#endif
+  return 0;
+}
@@ -0,0 +1,186 @@
+// Predicts the frame rate and CPU load of each display configuration with the timing model in
+// src/displays/TimingModel.h, by running the real EyeController against simulated displays and time.
+// Prints a table of the predictions, then checks that they are in a sensible range, and exits with 1 if
+// any of the checks fail. Build it with -D STREAM_STRIPS to see what streaming strips without frame buffers
+// does to the "direct" setup.
+// Run it with: platformio run -e native_timing && .pio/build/native_timing/program [simulated ms per eye]
+
+#include <cstdarg>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../displays/TimingModel.h"
+#include "../eyes/EyeController.h"
+#include "../native/Check.h"
+
+#include "../eyes/240x240/bigBlue.h"
+#include "../eyes/240x240/doe.h"
+#include "../eyes/240x240/hypnoRed.h"
+
+using Controller = EyeController<2, TimingModelDisplay, SimulatedTiming>;
+
+std::array<std::array<EyeDefinition, 2>, 3> timingEyes{{
+    {bigBlue::eye, bigBlue::eye}, {doe::left, doe::right}, {hypnoRed::eye, hypnoRed::eye},
+}};
+
+/// A display configuration, as it would be set up in config.h
+struct Setup {
+  const char *name;
+  bool useFrameBuffer;
+  bool asyncUpdates;
+  bool doubleBuffer;
+  bool changedRowsOnly;
+  bool interlace;
+  bool sharedBus;
+};
+
+const Setup setups[] = {
+    {"direct", false, false, false, false, false, false},
+    {"sync-bbox", true, false, false, false, false, false},
+    {"sync-rows", true, false, false, true, false, false},
+    {"interlace", true, false, false, true, true, false},
+    {"async", true, true, false, true, false, false},
+    {"double", true, true, true, true, false, false},
+    {"async-shared", true, true, false, true, false, true},
+    {"double-shared", true, true, true, true, false, true},
+};
+
+/// What the model predicted for one setup, eye and pixel format
+struct Prediction {
+  const Setup *setup;
+  const char *eye;
+  uint8_t bitsPerPixel;
+  TimingReport report;
+};
+
+/// \return the printf-style formatted text, however long it turns out.
+static std::string format(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+
+static std::string format(const char *fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  va_list copy;
+  va_copy(copy, args);
+  std::string text(static_cast<size_t>(std::max(vsnprintf(nullptr, 0, fmt, copy), 0)), '\0');
+  va_end(copy);
+  vsnprintf(&text[0], text.size() + 1, fmt, args);
+  va_end(args);
+  return text;
+}
+
+/// Records a check, only printing it if it fails, since there are a lot of them after the table.
+static void check(bool ok, const std::string &what) {
+  check(ok, what.c_str(), false);
+}
+
+static const Prediction *find(const std::vector<Prediction> &predictions, const char *setup, const char *eye,
+                              uint8_t bitsPerPixel) {
+  for (const Prediction &p: predictions) {
+    if (strcmp(p.setup->name, setup) == 0 && strcmp(p.eye, eye) == 0 && p.bitsPerPixel == bitsPerPixel) {
+      return &p;
+    }
+  }
+  return nullptr;
+}
+
+static TimingReport predict(const Setup &setup, std::array<EyeDefinition, 2> &defs, uint8_t bitsPerPixel,
+                            uint32_t durationMs) {
+  TimingModelConfig config{};
+  config.bitsPerPixel = bitsPerPixel;
+  config.useFrameBuffer = setup.useFrameBuffer;
+  config.asyncUpdates = setup.asyncUpdates;
+  config.doubleBuffer = setup.doubleBuffer;
+  config.changedRowsOnly = setup.changedRowsOnly;
+  config.interlace = setup.interlace;
+  config.sharedBus = setup.sharedBus;
+
+  TimingClock clock;
+  const std::unique_ptr<TimingModelDisplay> left(new TimingModelDisplay(clock, config));
+  const std::unique_ptr<TimingModelDisplay> right(new TimingModelDisplay(clock, config));
+  Controller controller({DisplayDefinition<TimingModelDisplay>{left.get(), defs[0]},
+                         DisplayDefinition<TimingModelDisplay>{right.get(), defs[1]}}, true, true, true);
+  const std::array<TimingModelDisplay *, 2> displays{left.get(), right.get()};
+  return runTimingModel(controller, clock, displays, durationMs,
+                        [&](uint32_t ms) { controller.getTiming().nowMs = ms; });
+}
+
+int main(int argc, char **argv) {
+  const uint32_t durationMs = argc > 1 ? strtoul(argv[1], nullptr, 10) : 3'000;
+  const TimingModelConfig defaults{};
+  printf("Predictions at %lu MHz SPI, %u simulated ms per eye\n",
+         static_cast<unsigned long>(defaults.spiHz / 1'000'000), durationMs);
+  printf("Each display has its own SPI port, except in the -shared setups where they take turns on one\n\n");
+  printf("%-14s %-4s %-12s %8s %9s %8s\n", "setup", "bpp", "eye", "fps", "cpu idle", "link");
+
+  std::vector<Prediction> predictions;
+  for (const Setup &setup: setups) {
+    // RGB444 can't have a frame buffer, so it's always drawn straight to the screen
+    const std::vector<uint8_t> formats = setup.useFrameBuffer ? std::vector<uint8_t>{16} :
+                                         std::vector<uint8_t>{16, 12};
+    for (const uint8_t bitsPerPixel: formats) {
+      for (auto &defs: timingEyes) {
+        const TimingReport report = predict(setup, defs, bitsPerPixel, durationMs);
+        predictions.push_back(Prediction{&setup, defs[0].name, bitsPerPixel, report});
+        printf("%-14s %-4s %-12s %8.1f %8.1f%% %7.1f%%\n", setup.name, bitsPerPixel == 12 ? "444" : "565",
+               defs[0].name, report.fps, report.cpuIdlePercent, report.linkPercent);
+      }
+    }
+  }
+  printf("\n");
+
+  for (const Prediction &p: predictions) {
+    const TimingReport &r = p.report;
+    check(r.fps >= 1.0f && r.fps <= 1000.0f,
+          format("%s/%s: %.1f fps is outside 1-1000", p.setup->name, p.eye, r.fps));
+    check(r.cpuIdlePercent >= 0.0f && r.cpuIdlePercent <= 100.0f && r.linkPercent >= 0.0f &&
+          r.linkPercent <= 100.0f, format("%s/%s: a percentage is outside 0-100", p.setup->name, p.eye));
+  }
+  for (auto &defs: timingEyes) {
+    const char *eye = defs[0].name;
+    const TimingReport &async = find(predictions, "async", eye, 16)->report;
+    const TimingReport &doubled = find(predictions, "double", eye, 16)->report;
+    const TimingReport &asyncShared = find(predictions, "async-shared", eye, 16)->report;
+    const TimingReport &doubleShared = find(predictions, "double-shared", eye, 16)->report;
+    const TimingReport &bbox = find(predictions, "sync-bbox", eye, 16)->report;
+    const TimingReport &rows = find(predictions, "sync-rows", eye, 16)->report;
+    const TimingReport &interlaced = find(predictions, "interlace", eye, 16)->report;
+    const TimingReport &direct565 = find(predictions, "direct", eye, 16)->report;
+    const TimingReport &direct444 = find(predictions, "direct", eye, 12)->report;
+
+    // Async DMA sends the whole frame each time, so the SPI clock puts a hard limit on the frame rate. A
+    // frame still being sent at the end of the run, and one queued behind it, are counted too.
+    const float frameBits = ChangedRows::width * ChangedRows::height * 16.0f;
+    const float inFlightFps = 2000.0f / static_cast<float>(durationMs);
+    const float fullFrameFps = static_cast<float>(defaults.spiHz) / frameBits + inFlightFps;
+    for (const TimingReport *r: {&async, &doubled}) {
+      check(r->fps <= fullFrameFps,
+            format("%s: async predicts %.1f fps, faster than whole frames can be sent (%.1f)", eye, r->fps,
+                   fullFrameFps));
+    }
+    // Sharing a bus, the two displays' frames go one after the other, though both can have frames in flight
+    for (const TimingReport *r: {&asyncShared, &doubleShared}) {
+      check(r->fps * 2.0f <= fullFrameFps + inFlightFps,
+            format("%s: a shared bus predicts %.1f fps per display, faster than it can send (%.1f in all)", eye,
+                   r->fps, fullFrameFps + inFlightFps));
+    }
+    check(asyncShared.fps <= async.fps && doubleShared.fps <= doubled.fps,
+          format("%s: a shared bus predicts %.1f/%.1f fps, more than separate ports (%.1f/%.1f)", eye,
+                 asyncShared.fps, doubleShared.fps, async.fps, doubled.fps));
+    check(doubled.fps >= async.fps,
+          format("%s: double buffering predicts %.1f fps, less than plain async (%.1f)", eye, doubled.fps,
+                 async.fps));
+    check(rows.fps >= bbox.fps,
+          format("%s: sending changed rows predicts %.1f fps, less than a bounding box (%.1f)", eye, rows.fps,
+                 bbox.fps));
+    check(interlaced.fps >= rows.fps,
+          format("%s: interlacing predicts %.1f fps, less than sending every changed row (%.1f)", eye,
+                 interlaced.fps, rows.fps));
+    check(direct444.fps >= direct565.fps,
+          format("%s: RGB444 predicts %.1f fps, less than 565 (%.1f)", eye, direct444.fps, direct565.fps));
+  }
+
+  return checkResult();
+}
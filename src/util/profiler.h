@@ -0,0 +1,184 @@
+#pragma once
+
+#include <Arduino.h>
+#include <array>
+
+// Time each phase of every frame the EyeController renders, keeping the most recent frames in a ring
+// buffer that can be printed over Serial with FrameProfiler::dump(). On a Teensy this uses the cycle
+// counter, on the host std::chrono. When this is not defined the profiler compiles away to nothing.
+//#define PROFILE_FRAMES
+
+#ifdef PROFILE_FRAMES
+#ifdef NATIVE_BUILD
+#include <chrono>
+#endif
+#endif
+
+/// The parts of a frame that are timed separately
+enum class FramePhase : uint8_t {
+  Wait,       // Looking for a display that's ready, including every call that found none
+  Behaviour,  // The automatic and time-based movement, blinking and pupil changes
+  Eyelids,    // Working out where the eyelids are
+  Render,     // Drawing the eye
+  Update,     // Sending the eye to its display
+  numPhases
+};
+
+constexpr size_t numFramePhases = static_cast<size_t>(FramePhase::numPhases);
+
+/// The number of frames the profiler remembers
+constexpr size_t profiledFrames{128};
+
+#ifdef PROFILE_FRAMES
+
+/// The timings of a single frame, in ticks
+struct FrameSample {
+  uint32_t frame;
+  uint8_t eye;
+  bool drawn;
+  /// The number of times renderFrame() found no display ready before this frame. A slow SPI clock or a
+  /// busy shared bus can make this run well past 16 bits.
+  uint32_t polls;
+  /// The time since the previous frame finished, including anything the main loop did in between
+  uint32_t period;
+  std::array<uint32_t, numFramePhases> phases;
+};
+
+/// Records how long each phase of the recent frames took.
+/// \tparam capacity the number of frames to remember.
+template<size_t capacity = profiledFrames>
+class FrameProfiler {
+private:
+  std::array<FrameSample, capacity> samples{};
+  size_t next{};
+  size_t count{};
+
+  FrameSample current{};
+  uint32_t frames{};
+  uint32_t last{};
+  uint32_t lastEnd{};
+
+#ifdef NATIVE_BUILD
+  static uint32_t ticks() {
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+  }
+
+  static float nsPerTick() {
+    return 1.0f;
+  }
+#else
+  static uint32_t ticks() {
+    return ARM_DWT_CYCCNT;
+  }
+
+  static float nsPerTick() {
+    return 1e9f / static_cast<float>(F_CPU_ACTUAL);
+  }
+#endif
+
+  static void printMicros(uint32_t ticks) {
+    Serial.printf(",%.2f", static_cast<float>(ticks) * nsPerTick() / 1000.0f);
+  }
+
+public:
+  FrameProfiler() {
+#ifndef NATIVE_BUILD
+    // Teensyduino starts the cycle counter at boot, but make sure
+    ARM_DEMCR |= ARM_DEMCR_TRCENA;
+    ARM_DWT_CTRL |= ARM_DWT_CTRL_CYCCNTENA;
+#endif
+  }
+
+  /// Call at the start of a frame, before looking for a display to draw on.
+  void begin() {
+    last = ticks();
+  }
+
+  /// Call at the end of a phase. The time since the end of the previous phase is added to it.
+  void mark(FramePhase phase) {
+    const uint32_t now = ticks();
+    current.phases[static_cast<size_t>(phase)] += now - last;
+    last = now;
+  }
+
+  /// Call instead of end() when no display was ready, so nothing was drawn.
+  void idle() {
+    mark(FramePhase::Wait);
+    current.polls++;
+  }
+
+  /// Call at the end of a frame, to store its timings.
+  /// \param eye the index of the eye that was rendered.
+  /// \param drawn whether anything changed, so the eye was sent to its display.
+  void end(size_t eye, bool drawn) {
+    current.frame = frames;
+    current.eye = static_cast<uint8_t>(eye);
+    current.drawn = drawn;
+    current.period = frames ? last - lastEnd : 0;
+    samples[next] = current;
+    next = (next + 1) % capacity;
+    count = std::min(count + 1, capacity);
+    current = FrameSample{};
+    frames++;
+    lastEnd = last;
+  }
+
+  /// Prints the stored frames over Serial as CSV, oldest first, followed by the mean and maximum of each
+  /// column. The times are in microseconds; "other" is the part of the period not spent in any phase.
+  /// The stored frames are then cleared.
+  void dump() {
+    Serial.println(F("frame,eye,drawn,polls,wait_us,behaviour_us,eyelids_us,render_us,update_us,other_us"));
+    std::array<uint64_t, numFramePhases + 1> totals{};
+    std::array<uint32_t, numFramePhases + 1> maximums{};
+    for (size_t i = 0; i < count; i++) {
+      const FrameSample &sample = samples[(next + capacity - count + i) % capacity];
+      Serial.printf("%lu,%u,%u,%lu", static_cast<unsigned long>(sample.frame), sample.eye, sample.drawn ? 1 : 0,
+                    static_cast<unsigned long>(sample.polls));
+      uint32_t inPhases = 0;
+      for (size_t p = 0; p < numFramePhases; p++) {
+        printMicros(sample.phases[p]);
+        inPhases += sample.phases[p];
+        totals[p] += sample.phases[p];
+        maximums[p] = std::max(maximums[p], sample.phases[p]);
+      }
+      // The first frame has no period, and a frame's wait can start before the previous one finished
+      const uint32_t other = sample.period > inPhases ? sample.period - inPhases : 0;
+      printMicros(other);
+      totals[numFramePhases] += other;
+      maximums[numFramePhases] = std::max(maximums[numFramePhases], other);
+      Serial.println();
+    }
+    if (count) {
+      Serial.print(F("mean,,,"));
+      for (const uint64_t total: totals) {
+        printMicros(static_cast<uint32_t>(total / count));
+      }
+      Serial.println();
+      Serial.print(F("max,,,"));
+      for (const uint32_t maximum: maximums) {
+        printMicros(maximum);
+      }
+      Serial.println();
+    }
+    next = count = 0;
+  }
+};
+
+#else
+
+/// Stands in for the profiler when PROFILE_FRAMES isn't defined, so the calls to it cost nothing.
+template<size_t capacity = profiledFrames>
+class FrameProfiler {
+public:
+  void begin() {}
+  void mark(FramePhase) {}
+  void idle() {}
+  void end(size_t, bool) {}
+
+  void dump() {
+    Serial.println(F("Frame profiling is disabled, define PROFILE_FRAMES in util/profiler.h"));
+  }
+};
+
+#endif
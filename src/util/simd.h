@@ -0,0 +1,80 @@
+#pragma once
+
+#include <Arduino.h>
+#include <cstring>
+
+#if defined(__ARM_FEATURE_SIMD32)
+#include <arm_acle.h>
+#endif
+
+/// Operations on pairs of 16-bit values packed into a single 32-bit word, with the first value in
+/// the low half. These map onto the Cortex-M7's DSP instructions where they are available, and fall
+/// back to plain C++ that gives exactly the same results everywhere else.
+namespace simd {
+
+using Pair = uint32_t;
+
+/// Packs two values into a pair. Each is truncated to 16 bits.
+__attribute__((always_inline)) inline Pair pack(int32_t low, int32_t high) {
+  return static_cast<uint16_t>(low) | static_cast<uint32_t>(high) << 16;
+}
+
+/// \return the first (low) value of a pair, sign extended.
+__attribute__((always_inline)) inline int32_t low(Pair p) {
+  return static_cast<int16_t>(p);
+}
+
+/// \return the second (high) value of a pair, sign extended.
+__attribute__((always_inline)) inline int32_t high(Pair p) {
+  return static_cast<int16_t>(p >> 16);
+}
+
+/// Adds two pairs of signed values, lane by lane.
+__attribute__((always_inline)) inline Pair add(Pair a, Pair b) {
+#if defined(__ARM_FEATURE_SIMD32)
+  return __sadd16(a, b);
+#else
+  return pack(low(a) + low(b), high(a) + high(b));
+#endif
+}
+
+/// Subtracts one pair of signed values from another, lane by lane.
+__attribute__((always_inline)) inline Pair sub(Pair a, Pair b) {
+#if defined(__ARM_FEATURE_SIMD32)
+  return __ssub16(a, b);
+#else
+  return pack(low(a) - low(b), high(a) - high(b));
+#endif
+}
+
+/// Compares each lane of a pair against a limit and picks one of two values for that lane.
+/// The comparison is unsigned, so negative values are never below the limit.
+/// \param a the values to compare.
+/// \param limit the limits to compare against.
+/// \param below the values to pick for lanes where a is less than the limit.
+/// \param otherwise the values to pick for lanes where a is greater than or equal to the limit.
+/// \return the values that were picked.
+__attribute__((always_inline)) inline Pair selectBelow(Pair a, Pair limit, Pair below, Pair otherwise) {
+#if defined(__ARM_FEATURE_SIMD32)
+  // USUB16 sets the GE flag of each lane that doesn't borrow, i.e. where a >= limit, and SEL picks
+  // from its first operand for those lanes. They're kept together so nothing can disturb the flags.
+  Pair result;
+  asm("usub16 %0, %1, %2\n\t"
+      "sel %0, %4, %3"
+      : "=&r"(result)
+      : "r"(a), "r"(limit), "r"(below), "r"(otherwise)
+      : "cc");
+  return result;
+#else
+  const Pair lowLane = static_cast<uint16_t>(a) < static_cast<uint16_t>(limit) ? below : otherwise;
+  const Pair highLane = (a >> 16) < (limit >> 16) ? below : otherwise;
+  return (lowLane & 0xFFFF) | (highLane & 0xFFFF0000);
+#endif
+}
+
+/// Stores a pair of values to memory that might not be 32-bit aligned, as a single write.
+__attribute__((always_inline)) inline void store(uint16_t *destination, Pair p) {
+  memcpy(destination, &p, sizeof(p));
+}
+
+}
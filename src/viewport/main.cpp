@@ -0,0 +1,111 @@
+// Checks that both eyes on a shared panel come out whole and the right way round. The eyes are drawn through
+// Viewports onto a panel in RAM, and at the same time onto RAM displays of their own, and every frame of the
+// panel is compared with the eyes' own displays.
+// Prints each check and exits with 1 if any of them fail.
+// Run it with: platformio run -e native_viewport && .pio/build/native_viewport/program
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+#include "../displays/RamDisplay.h"
+#include "../displays/Viewport.h"
+#include "../eyes/EyeController.h"
+#include "../native/Check.h"
+
+#include "../eyes/240x240/bigBlue.h"
+#include "../eyes/240x240/doe.h"
+#include "../eyes/240x240/hypnoRed.h"
+
+std::array<std::array<EyeDefinition, 2>, 3> viewportEyes{{
+    {bigBlue::eye, bigBlue::eye}, {doe::left, doe::right}, {hypnoRed::eye, hypnoRed::eye},
+}};
+
+/// The number of frames drawn of each eye
+constexpr uint32_t FRAMES_PER_EYE{60};
+
+/// The simulated time between frames
+constexpr uint32_t FRAME_MS{7};
+
+/// What the panel is filled with before anything is drawn, to show up anything drawn outside the eyes
+constexpr uint16_t UNDRAWN{0xF81F};
+
+/// Runs the eyes on a panel and on displays of their own, and checks the panel against the eyes' displays.
+/// \tparam width the width of the panel.
+/// \tparam height the height of the panel.
+/// \param expectedSize the size each eye should be drawn at on the panel.
+template<int16_t width, int16_t height>
+static void checkPanel(int16_t expectedSize) {
+  using Panel = BasicRamDisplay<width, height>;
+  const std::unique_ptr<Panel> panel(new Panel());
+  std::fill(panel->frameBuffer(), panel->frameBuffer() + width * height, UNDRAWN);
+  const auto viewports = splitPanel(panel.get(), width, height, true);
+  const std::unique_ptr<Viewport<Panel>> left(viewports[0]), right(viewports[1]);
+  const std::unique_ptr<RamDisplay> ownLeft(new RamDisplay(true)), ownRight(new RamDisplay(false));
+  const std::array<RamDisplay *, 2> own{ownLeft.get(), ownRight.get()};
+  for (RamDisplay *display: own) {
+    std::fill(display->frameBuffer(), display->frameBuffer() + RamDisplay::width * RamDisplay::height, UNDRAWN);
+  }
+
+  // Where each eye should land: centred in its half of the panel, as large as fits
+  const int16_t half = width / 2;
+  const int16_t size = std::min<int16_t>({half, height, RamDisplay::width});
+  const int16_t top = (height - size) / 2;
+  const std::array<int16_t, 2> eyeLeft{static_cast<int16_t>((half - size) / 2),
+                                       static_cast<int16_t>(half + (half - size) / 2)};
+
+  uint32_t stray = 0;
+  std::array<uint32_t, 2> wrong{};
+  for (size_t eye = 0; eye < viewportEyes.size(); eye++) {
+    auto &defs = viewportEyes[eye];
+    EyeController<2, Viewport<Panel>, SimulatedTiming> onPanel(
+        {DisplayDefinition<Viewport<Panel>>{left.get(), defs[0]},
+         DisplayDefinition<Viewport<Panel>>{right.get(), defs[1]}}, true, true, true);
+    EyeController<2, RamDisplay, SimulatedTiming> onOwn(
+        {DisplayDefinition<RamDisplay>{ownLeft.get(), defs[0]}, DisplayDefinition<RamDisplay>{ownRight.get(), defs[1]}},
+        true, true, true);
+    for (uint32_t frame = 0; frame < FRAMES_PER_EYE; frame++) {
+      onPanel.getTiming().advance(FRAME_MS);
+      onOwn.getTiming().advance(FRAME_MS);
+      onPanel.renderFrame();
+      onOwn.renderFrame();
+
+      for (int16_t y = 0; y < height; y++) {
+        for (int16_t x = 0; x < width; x++) {
+          const uint16_t pixel = panel->get(x, y);
+          const size_t side = x < half ? 0 : 1;
+          const int16_t eyeX = x - eyeLeft[side], eyeY = y - top;
+          if (eyeX < 0 || eyeX >= size || eyeY < 0 || eyeY >= size) {
+            stray += pixel != UNDRAWN ? 1 : 0;
+            continue;
+          }
+          // The pixel of the eye's own display under the middle of this one
+          const int16_t ownX = (2 * eyeX + 1) * RamDisplay::width / (2 * size);
+          const int16_t ownY = (2 * eyeY + 1) * RamDisplay::height / (2 * size);
+          if (pixel != own[side]->get(ownX, ownY)) {
+            wrong[side]++;
+          }
+        }
+      }
+    }
+  }
+
+  char what[96];
+  snprintf(what, sizeof(what), "%dx%d panel: the left eye is drawn whole at %d px, mirrored, in every frame", width,
+           height, expectedSize);
+  check(size == expectedSize && wrong[0] == 0, what);
+  snprintf(what, sizeof(what), "%dx%d panel: the right eye is drawn whole at %d px in every frame", width, height,
+           expectedSize);
+  check(size == expectedSize && wrong[1] == 0, what);
+  snprintf(what, sizeof(what), "%dx%d panel: nothing is drawn outside the eyes", width, height);
+  check(stray == 0, what);
+}
+
+int main() {
+  // A 240x320 ST7789 rotated to landscape, where each eye has to shrink to fit its half
+  checkPanel<320, 240>(160);
+  // Panels with room for both eyes at full size, so they're only moved into place
+  checkPanel<480, 240>(240);
+  checkPanel<480, 320>(240);
+  return checkResult();
+}